@@ -0,0 +1,92 @@
+// Copyright 2025 Bootj05
+//
+// Licensed under the MIT License.
+//
+// Host benchmark for the effect engine and the command parser. Build and
+// run it with `pio run -e bench -t exec`; see README.md.
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "effects.h"
+#include "utils.h"
+
+namespace {
+
+const uint16_t LEDS = 13;
+const uint32_t FRAMES = 200000;
+const uint32_t COMMAND_ROUNDS = 200000;
+
+const char *const TYPE_NAMES[PRESET_TYPE_COUNT] = {
+    "STATIC", "RAINBOW", "POLICE_NL", "POLICE_USA", "STROBE",
+    "LAVALAMP", "FIRE", "CANDLE", "PARTY", "CUSTOM"};
+
+const char *const COMMANDS[] = {
+    "next", "set:3", "bright:128", "color:#11aaff", "speed:40",
+    "leds:#ff0000,#00ff00,#0000ff,#ffffff,#000000,#123456,#abcdef",
+    "bogus:1"};
+
+typedef std::chrono::steady_clock Clock;
+
+double nsSince(Clock::time_point start, uint32_t n) {
+  std::chrono::duration<double, std::nano> d = Clock::now() - start;
+  return d.count() / n;
+}
+
+// Keeps the optimizer from discarding the rendered frames
+volatile uint8_t sink;
+
+void benchEffects() {
+  CRGB custom[LEDS];
+  for (uint16_t i = 0; i < LEDS; ++i)
+    custom[i] = CRGB(i * 19, 255 - i * 7, i * 3);
+  printf("%-12s %12s %10s\n", "effect", "ns/frame", "changed");
+  for (size_t t = 0; t < PRESET_TYPE_COUNT; ++t) {
+    EffectEngine engine;
+    EffectParams p;
+    p.color = CRGB(0x123456);
+    p.leds = custom;
+    p.ledCount = LEDS;
+    engine.activate(static_cast<PresetType>(t), p);
+    CRGB out[LEDS];
+    uint32_t changed = 0;
+    Clock::time_point start = Clock::now();
+    // 20 ms apart, the firmware's default frame interval
+    for (uint32_t f = 0; f < FRAMES; ++f) {
+      if (engine.render(out, LEDS, f * 20))
+        ++changed;
+    }
+    double ns = nsSince(start, FRAMES);
+    sink = out[0].r;
+    printf("%-12s %12.1f %9.1f%%\n", TYPE_NAMES[t], ns,
+           100.0 * changed / FRAMES);
+  }
+}
+
+void benchCommands() {
+  const size_t count = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+  size_t lens[count];
+  for (size_t i = 0; i < count; ++i)
+    lens[i] = strlen(COMMANDS[i]);
+  printf("\n%-12s %12s\n", "command", "ns/parse");
+  Command cmd;
+  for (size_t i = 0; i < count; ++i) {
+    Clock::time_point start = Clock::now();
+    for (uint32_t r = 0; r < COMMAND_ROUNDS; ++r)
+      parseCommand(COMMANDS[i], lens[i], cmd);
+    double ns = nsSince(start, COMMAND_ROUNDS);
+    sink = static_cast<uint8_t>(cmd.type);
+    char name[13];
+    snprintf(name, sizeof(name), "%s", COMMANDS[i]);
+    printf("%-12s %12.1f\n", name, ns);
+  }
+}
+
+}  // namespace
+
+int main() {
+  benchEffects();
+  benchCommands();
+  return 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stdint.h>
+
+/**
+ * Debounces a button from timestamped edges instead of periodic polling.
+ *
+ * The first edge after a quiet period is reported immediately, so a press
+ * has no added latency. Edges within `windowMs` of an accepted change are
+ * treated as contact bounce; the level they leave behind is picked up by
+ * poll() once the window has passed, so short taps are not lost.
+ */
+class Debouncer {
+ public:
+  explicit Debouncer(uint32_t windowMs)
+      : window_(windowMs), stable_(false), raw_(false), changed_(0) {}
+
+  /**
+   * Feed a raw edge sampled at @p time.
+   * @return true if the debounced state changed
+   */
+  bool edge(bool pressed, uint32_t time) {
+    raw_ = pressed;
+    return settle(time);
+  }
+
+  /**
+   * Commit a level that settled during the bounce window.
+   * @return true if the debounced state changed
+   */
+  bool poll(uint32_t now) { return settle(now); }
+
+  bool pressed() const { return stable_; }
+
+ private:
+  bool settle(uint32_t now) {
+    if (raw_ == stable_ || now - changed_ < window_)
+      return false;
+    stable_ = raw_;
+    changed_ = now;
+    return true;
+  }
+
+  uint32_t window_;
+  bool stable_;
+  bool raw_;
+  uint32_t changed_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stdint.h>
+
+#include <atomic>
+
+/**
+ * Lock-free double buffer for handing state from one writer to one reader.
+ *
+ * The writer fills the back slot and then publishes it by flipping the
+ * front index. Each slot carries a sequence counter that is odd while the
+ * slot is being written, so a reader that raced with two quick writes
+ * detects the torn copy and simply retries. Neither side ever blocks.
+ */
+template <typename T>
+class DoubleBuffer {
+ public:
+  DoubleBuffer() : front_(0), generation_(0) {
+    seq_[0].store(0);
+    seq_[1].store(0);
+  }
+
+  /** Publish a new value. Must only be called from a single writer. */
+  void write(const T &value) {
+    uint8_t back = front_.load(std::memory_order_relaxed) ^ 1U;
+    seq_[back].fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slots_[back] = value;
+    seq_[back].fetch_add(1, std::memory_order_release);
+    front_.store(back, std::memory_order_release);
+    generation_.fetch_add(1, std::memory_order_release);
+  }
+
+  /** Copy the most recently published value into @p out. */
+  void read(T &out) const {
+    for (;;) {
+      uint8_t idx = front_.load(std::memory_order_acquire);
+      uint32_t before = seq_[idx].load(std::memory_order_acquire);
+      if (before & 1U)
+        continue;
+      out = slots_[idx];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_[idx].load(std::memory_order_relaxed) == before)
+        return;
+    }
+  }
+
+  /** Number of values published so far; changes on every write(). */
+  uint32_t generation() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+ private:
+  T slots_[2];
+  std::atomic<uint32_t> seq_[2];
+  std::atomic<uint8_t> front_;
+  std::atomic<uint32_t> generation_;
+};
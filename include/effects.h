@@ -0,0 +1,200 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stddef.h>
+#include <stdint.h>
+
+#include <FastLED.h>
+
+// Upper bound for the per-effect lookup tables built on activation
+#ifndef EFFECT_MAX_LEDS
+#define EFFECT_MAX_LEDS 64
+#endif
+
+// Animation phase is counted in steps with this many fractional bits
+constexpr uint8_t PHASE_SHIFT = 8;
+constexpr uint32_t PHASE_ONE = 1UL << PHASE_SHIFT;
+
+/**
+ * Types of LED animations.
+ *
+ * - `STATIC` &mdash; Solid color chosen per preset.
+ * - `RAINBOW` &mdash; Continuously cycling rainbow.
+ * - `POLICE_NL` &mdash; Segmented blue pattern with timed strobe like Dutch police lights.
+ * - `POLICE_USA` &mdash; Red, white and blue pattern similar to US police lights.
+ * - `STROBE` &mdash; Fast white flash on and off.
+ * - `LAVALAMP` &mdash; Slowly moving color gradient.
+ * - `FIRE`       Randomized warm flicker
+ * - `CANDLE`     Single warm flickering glow
+ * - `PARTY`      Random bright colors
+ * - `CUSTOM`     Per-LED colors stored from the client
+ */
+enum class PresetType {
+  STATIC,
+  RAINBOW,
+  POLICE_NL,
+  POLICE_USA,
+  STROBE,
+  LAVALAMP,
+  FIRE,
+  CANDLE,
+  PARTY,
+  CUSTOM
+};
+
+constexpr size_t PRESET_TYPE_COUNT =
+    static_cast<size_t>(PresetType::CUSTOM) + 1;
+
+/** A logical group of LEDs in the frame, e.g. one lens. */
+struct LedSegment {
+  uint16_t first;
+  uint16_t count;
+};
+
+/** Inputs an effect reads while rendering. */
+struct EffectParams {
+  CRGB color = CRGB::Black;      // STATIC
+  const CRGB *leds = nullptr;    // CUSTOM, one entry per LED
+  uint16_t ledCount = 0;
+  uint16_t stepMs = 50;          // Duration of one animation step
+  // Groups POLICE_NL alternates between; read by init() only
+  const LedSegment *segments = nullptr;
+  uint8_t segmentCount = 0;
+};
+
+struct RainbowState {
+  uint8_t hue;
+};
+
+struct PoliceNlState {
+  bool phase;           // false = groups 1&3, true = groups 2&4
+  bool strobeOn;
+  uint8_t strobeGroup;  // 1 or 2 when strobing, 0 otherwise
+  uint32_t flashCount;
+};
+
+struct PoliceUsaState {
+  uint8_t step;
+};
+
+struct RandomState {
+  uint32_t step;
+};
+
+struct StrobeState {
+  bool on;
+};
+
+struct LavaState {
+  uint8_t pos;
+};
+
+/**
+ * Per-effect state owned by an EffectEngine. Only the member matching the
+ * active effect is meaningful; `lut` holds tables precomputed by init().
+ */
+struct EffectState {
+  uint16_t count;
+  union {
+    RainbowState rainbow;
+    PoliceNlState policeNl;
+    PoliceUsaState policeUsa;
+    StrobeState strobe;
+    LavaState lava;
+    RandomState random;
+  };
+  uint8_t lut[EFFECT_MAX_LEDS];
+};
+
+/**
+ * Effect interface. `init` resets the state and builds lookup tables for
+ * `count` LEDs and the parameters' segments, `tick` derives the state from
+ * the animation phase (in steps, PHASE_SHIFT fractional bits) and reports
+ * whether the frame changed, `render` draws the current frame into `out`.
+ * Effects that are not `animated` never change on their own, so callers
+ * may stop rendering them until their parameters change.
+ */
+struct Effect {
+  void (*init)(EffectState &s, const EffectParams &p, uint16_t count);
+  bool (*tick)(EffectState &s, uint32_t phase);
+  void (*render)(const EffectState &s, const EffectParams &p, CRGB *out,
+                 uint16_t count);
+  bool animated;
+};
+
+/** Look up the effect implementing a preset type. */
+const Effect &effectFor(PresetType type);
+
+/**
+ * Blend position (0 = all @p from, 255 = all @p to) after @p elapsed ms of
+ * a crossfade lasting @p duration ms.
+ */
+uint8_t crossfadeAmount(uint32_t elapsed, uint32_t duration);
+
+/**
+ * Write @p from blended towards @p to by @p amount / 255 into @p out using
+ * 8-bit fixed-point math. @p out may alias @p from.
+ */
+void crossfade(const CRGB *from, const CRGB *to, uint8_t amount, CRGB *out,
+               uint16_t count);
+
+/**
+ * Phase reached @p elapsed ms after an effect stepping every @p stepMs was
+ * at @p phase. @p elapsed may be negative to look back.
+ */
+uint32_t extrapolatePhase(uint32_t phase, int32_t elapsed, uint32_t stepMs);
+
+/**
+ * Runs one effect instance and renders it into any buffer.
+ * Several engines can run side by side since each owns its state.
+ *
+ * The engine keeps the animation clock: elapsed time is converted into
+ * steps of `EffectParams::stepMs`, so the render rate only affects
+ * smoothness and `stepMs` only affects speed.
+ */
+class EffectEngine {
+ public:
+  EffectEngine();
+
+  /** Switch to @p type; its state is reset on the next render(). */
+  void activate(PresetType type, const EffectParams &params);
+
+  /**
+   * Replace the parameters of the running effect without resetting it.
+   * A new `stepMs` applies from now on without a jump in phase.
+   */
+  void setParams(const EffectParams &params);
+
+  /**
+   * Advance to @p now and draw @p count LEDs into @p out if the frame
+   * changed. LEDs beyond EFFECT_MAX_LEDS are left black.
+   * @return true if @p out was written
+   */
+  bool render(CRGB *out, uint16_t count, uint32_t now);
+
+  /**
+   * Continue from @p phase as of @p now, e.g. to follow another unit's
+   * clock. Call right before render() with the same @p now.
+   */
+  void syncPhase(uint32_t phase, uint32_t now);
+
+  PresetType type() const { return type_; }
+
+  /** Whether frames change over time without new parameters. */
+  bool animated() const { return effect_->animated; }
+
+  /** Current animation phase in steps with PHASE_SHIFT fractional bits. */
+  uint32_t phase() const { return phase_; }
+
+ private:
+  void advance(uint32_t now);
+
+  PresetType type_;
+  const Effect *effect_;
+  EffectParams params_;
+  EffectState state_;
+  bool dirty_;
+  bool started_;
+  uint32_t lastNow_;
+  uint32_t phase_;
+  uint32_t phaseRemainder_;
+};
@@ -0,0 +1,80 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stddef.h>
+#include <stdint.h>
+
+#include <FastLED.h>
+
+/**
+ * Keyframe sequences: authored animations of any length, read in place
+ * from flash. Layout (little endian):
+ *   [magic][version][flags][reserved][ledCount u16][frameCount u16]
+ *   then frameCount keyframes of [durationMs u16][r g b]...
+ * Each keyframe fades into the next over its duration; a duration of 0
+ * cuts straight to the next one. With SEQUENCE_FLAG_LOOP the last
+ * keyframe fades back into the first, otherwise playback stops on it.
+ */
+constexpr uint8_t SEQUENCE_MAGIC = 0x53;  // 'S'
+constexpr uint8_t SEQUENCE_VERSION = 1;
+constexpr size_t SEQUENCE_HEADER = 8;
+constexpr uint8_t SEQUENCE_FLAG_LOOP = 0x01;
+
+struct SequenceInfo {
+  const uint8_t *frames = nullptr;  // First keyframe, null if none
+  uint16_t ledCount = 0;
+  uint16_t frameCount = 0;
+  bool loop = false;
+  uint32_t durationMs = 0;  // One pass through all keyframes
+};
+
+/** Bytes of one keyframe for @p ledCount LEDs. */
+constexpr size_t sequenceFrameSize(uint16_t ledCount) {
+  return 2 + 3 * static_cast<size_t>(ledCount);
+}
+
+/**
+ * Total size of the sequence described by the SEQUENCE_HEADER bytes at
+ * @p header, or 0 if they are not a valid header. Sequences may cover at
+ * most EFFECT_MAX_LEDS LEDs.
+ */
+size_t sequenceSize(const uint8_t *header);
+
+/**
+ * Validate the sequence at @p data, of which @p len bytes are readable.
+ * @return false for a bad header, data past @p len or a looping sequence
+ *         without any duration
+ */
+bool parseSequence(const uint8_t *data, size_t len, SequenceInfo &info);
+
+/**
+ * Plays a sequence. Keyframes are read from the sequence data as they are
+ * needed, so RAM use does not depend on the sequence length.
+ */
+class SequencePlayer {
+ public:
+  SequencePlayer();
+
+  /** Start @p seq from its first keyframe at @p now. */
+  void start(const SequenceInfo &seq, uint32_t now);
+
+  /**
+   * Advance to @p now and draw @p count LEDs into @p out if the frame
+   * changed. LEDs the sequence does not cover are black.
+   * @return true if @p out was written
+   */
+  bool render(CRGB *out, uint16_t count, uint32_t now);
+
+  /** False once a sequence without loop rests on its last keyframe. */
+  bool playing() const { return playing_; }
+
+ private:
+  const uint8_t *frame(uint16_t index) const;
+  uint16_t duration(uint16_t index) const;
+  void advance(uint32_t now);
+
+  SequenceInfo seq_;
+  uint16_t index_;
+  uint32_t frameStart_;
+  bool playing_;
+  bool drawn_;
+};
@@ -0,0 +1,47 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+/**
+ * Fixed-size lock-free queue for one producer and one consumer, e.g. an
+ * interrupt handler feeding loop(). push() and pop() never block and
+ * never allocate, so both are safe to call from an ISR.
+ *
+ * @tparam N capacity; one slot is kept free to tell full from empty
+ */
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2, "SpscQueue needs at least two slots");
+
+ public:
+  SpscQueue() : head_(0), tail_(0) {}
+
+  /** Append @p value. @return false, dropping it, if the queue is full */
+  bool push(const T &value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t next = (tail + 1) % N;
+    if (next == head_.load(std::memory_order_acquire))
+      return false;
+    slots_[tail] = value;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /** Take the oldest value. @return false if the queue is empty */
+  bool pop(T &out) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    out = slots_[head];
+    head_.store((head + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T slots_[N];
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+};
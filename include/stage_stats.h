@@ -0,0 +1,96 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Fixed-size duration histogram for profiling one stage of the main loop.
+ *
+ * Durations (microseconds) below 8 get a bucket each; above that every
+ * power of two is split into four buckets, so percentiles are accurate to
+ * within 25% while the whole histogram stays a few hundred bytes. Values
+ * beyond MAX_US land in the last bucket. record() never allocates and is
+ * cheap enough to call on every loop() iteration.
+ */
+class StageStats {
+ public:
+  static const uint32_t MAX_US = 1UL << 20;
+  static const size_t BUCKETS = 8 + (20 - 3) * 4;
+
+  StageStats() { reset(); }
+
+  void reset() {
+    for (size_t i = 0; i < BUCKETS; ++i)
+      buckets_[i] = 0;
+    count_ = 0;
+    sum_ = 0;
+    min_ = UINT32_MAX;
+    max_ = 0;
+  }
+
+  void record(uint32_t us) {
+    ++buckets_[bucketFor(us)];
+    ++count_;
+    sum_ += us;
+    if (us < min_)
+      min_ = us;
+    if (us > max_)
+      max_ = us;
+  }
+
+  uint32_t count() const { return count_; }
+  uint64_t sum() const { return sum_; }
+  uint32_t min() const { return count_ ? min_ : 0; }
+  uint32_t max() const { return max_; }
+  uint32_t avg() const {
+    return count_ ? static_cast<uint32_t>(sum_ / count_) : 0;
+  }
+
+  /**
+   * Upper bound of the bucket holding the @p permille-th sample, e.g.
+   * 990 for p99. Never exceeds the largest recorded value.
+   */
+  uint32_t percentile(uint32_t permille) const {
+    if (count_ == 0)
+      return 0;
+    uint64_t rank = (static_cast<uint64_t>(count_) * permille + 999) / 1000;
+    if (rank == 0)
+      rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        uint32_t upper = bucketUpper(i);
+        return upper < max_ ? upper : max_;
+      }
+    }
+    return max_;
+  }
+
+ private:
+  static size_t bucketFor(uint32_t us) {
+    if (us < 8)
+      return us;
+    if (us >= MAX_US)
+      return BUCKETS - 1;
+    uint8_t octave = 31 - __builtin_clz(us);
+    size_t sub = (us >> (octave - 2)) & 3U;
+    return 8 + (octave - 3) * 4 + sub;
+  }
+
+  static uint32_t bucketUpper(size_t idx) {
+    if (idx < 8)
+      return idx;
+    if (idx == BUCKETS - 1)
+      return UINT32_MAX;
+    size_t octave = 3 + (idx - 8) / 4;
+    uint32_t sub = (idx - 8) % 4;
+    return (1UL << octave) + ((sub + 1) << (octave - 2)) - 1;
+  }
+
+  uint32_t buckets_[BUCKETS];
+  uint32_t count_;
+  uint64_t sum_;
+  uint32_t min_;
+  uint32_t max_;
+};
@@ -0,0 +1,68 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stddef.h>
+#include <stdint.h>
+
+#include "effects.h"
+
+/**
+ * Compile-time LED topology. The strips are concatenated into one frame
+ * buffer in the order listed, so effects render a single array of
+ * totalLeds() LEDs; segments name logical parts of that array. Each strip
+ * gets its own RMT channel and FastLED clocks them out in parallel, so
+ * show time depends on the longest strip rather than the LED total.
+ *
+ * Pick a variant with a build flag, e.g. `-DLED_TOPOLOGY_TWIN_RING`.
+ */
+struct StripSpec {
+  uint8_t pin;
+  uint16_t count;
+};
+
+/** Number of LEDs in @p strips before strip @p index. */
+template <size_t N>
+constexpr uint16_t stripOffset(const StripSpec (&strips)[N], size_t index) {
+  return index == 0 ? 0
+                    : strips[index - 1].count + stripOffset(strips, index - 1);
+}
+
+template <size_t N>
+constexpr uint16_t totalLeds(const StripSpec (&strips)[N]) {
+  return stripOffset(strips, N);
+}
+
+/** True if every segment from @p index on lies within @p ledCount LEDs. */
+template <size_t N>
+constexpr bool segmentsFit(const LedSegment (&segments)[N], uint16_t ledCount,
+                           size_t index = 0) {
+  return index == N ||
+         (segments[index].first + segments[index].count <= ledCount &&
+          segmentsFit(segments, ledCount, index + 1));
+}
+
+namespace topology {
+
+#if defined(LED_TOPOLOGY_TWIN_RING)
+// One 16 LED ring per lens and a 24 LED headband strip
+constexpr StripSpec STRIPS[] = {{2, 16}, {4, 16}, {5, 24}};
+constexpr LedSegment SEGMENTS[] = {{0, 16}, {16, 16}, {32, 24}};
+#else
+// The original goggles: a single 13 LED strip in four groups
+constexpr StripSpec STRIPS[] = {{2, 13}};
+constexpr LedSegment SEGMENTS[] = {{0, 3}, {3, 3}, {6, 3}, {9, 4}};
+#endif
+
+constexpr size_t STRIP_COUNT = sizeof(STRIPS) / sizeof(STRIPS[0]);
+constexpr size_t SEGMENT_COUNT = sizeof(SEGMENTS) / sizeof(SEGMENTS[0]);
+constexpr uint16_t LED_COUNT = totalLeds(STRIPS);
+
+// The ESP32 has eight RMT channels
+static_assert(STRIP_COUNT >= 1 && STRIP_COUNT <= 8,
+              "topology needs 1 to 8 strips");
+static_assert(SEGMENT_COUNT <= UINT8_MAX, "too many segments");
+static_assert(segmentsFit(SEGMENTS, LED_COUNT),
+              "segment extends past the last LED");
+static_assert(LED_COUNT <= EFFECT_MAX_LEDS,
+              "raise EFFECT_MAX_LEDS for this topology");
+
+}  // namespace topology
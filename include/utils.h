@@ -1,5 +1,419 @@
 #pragma once
 // Copyright 2025 Bootj05
+#include <stddef.h>
 #include <stdint.h>
 
 bool parseHexColor(const char *hex, uint32_t &value);
+// Same as above for a 6 character span that need not be NUL-terminated
+bool parseHexColor(const char *hex, size_t len, uint32_t &value);
+
+/** Commands understood over WebSocket, Bluetooth and HTTP. */
+enum class CommandType : uint8_t {
+    UNKNOWN,
+    NEXT,     // next
+    PREV,     // prev
+    SET,      // set:<index>
+    BRIGHT,   // bright:<0-255>
+    COLOR,    // color:#RRGGBB
+    SPEED,    // speed:<ms>
+    FRAME,    // frame:<ms>
+    FADE,     // fade:<ms>, 0 = hard cut
+    LEDS,     // leds:#RRGGBB,...
+    SAVE,     // save
+    STATS,    // stats
+    SYNC,     // sync:off|leader|follower, value is a SyncRole
+    PLAY      // play, starts the stored keyframe sequence
+};
+
+// Longest preset crossfade accepted by fade:<ms>
+constexpr uint32_t MAX_FADE_MS = 10000;
+// Longest render period accepted by frame:<ms>
+constexpr uint32_t MAX_FRAME_MS = 1000;
+
+/**
+ * Parsed command. `value` holds the index, brightness, interval or 0xRRGGBB
+ * color; LEDS fills `leds[0..ledCount)`.
+ */
+struct Command {
+    static const size_t MAX_LEDS = 64;
+
+    CommandType type;
+    uint32_t value;
+    size_t ledCount;
+    uint32_t leds[MAX_LEDS];
+};
+
+/**
+ * Parse one command from @p len bytes at @p msg without allocating. Values
+ * are range checked except SET indices, which depend on the preset list.
+ * @return false and type UNKNOWN for unknown or malformed input
+ */
+bool parseCommand(const char *msg, size_t len, Command &cmd);
+
+/**
+ * Strip a leading "<token>:" from the span.
+ * @return false, leaving the span untouched, if the prefix is missing
+ */
+bool stripToken(const char *&msg, size_t &len, const char *token);
+
+/**
+ * Delay before reconnect attempt @p attempt (counting from 0): @p baseMs
+ * doubled per attempt and capped at @p maxMs.
+ */
+uint32_t backoffDelay(uint8_t attempt, uint32_t baseMs, uint32_t maxMs);
+
+/**
+ * Split the next command off a batch such as "next;bright:128\ncolor:#ff0000".
+ * Commands are separated by ';' or newlines; surrounding whitespace and
+ * empty commands are skipped. @p msg and @p len are advanced past it.
+ * @return false once the batch holds no further command
+ */
+bool nextBatchCommand(const char *&msg, size_t &len, const char *&cmd,
+                      size_t &cmdLen);
+
+/**
+ * Binary WebSocket frame carrying raw colors for live streaming:
+ * [LED_FRAME_RGB][start LED, 16 bit big endian][r g b]...
+ */
+constexpr uint8_t LED_FRAME_RGB = 0x01;
+constexpr size_t LED_FRAME_HEADER = 3;
+
+/** Decoded LED frame; `rgb` points into the original payload. */
+struct LedFrame {
+    uint16_t start;
+    uint16_t count;
+    const uint8_t *rgb;
+};
+
+/**
+ * Validate a binary LED frame without copying it.
+ * @return false for a wrong opcode, a truncated header or partial colors
+ */
+bool parseLedFrame(const uint8_t *data, size_t len, LedFrame &frame);
+
+/**
+ * Realtime pixel input over UDP. DDP (port 4048) and E1.31/sACN (port
+ * 5568) headers are decoded separately from their payload, so the pixel
+ * data can be read from the socket straight into the frame buffer.
+ */
+constexpr uint16_t DDP_PORT = 4048;
+constexpr size_t DDP_HEADER = 10;
+constexpr size_t DDP_TIMECODE = 4;  // Extra header bytes if flagged
+constexpr uint16_t E131_PORT = 5568;
+constexpr size_t E131_HEADER = 126;  // Up to and including the start code
+
+/** Where a packet's pixel bytes go; offsets and lengths are in bytes. */
+struct PixelPacket {
+    size_t headerLen;   // Payload starts here
+    uint32_t offset;    // First byte in the frame buffer
+    size_t dataLen;     // Payload bytes present in the packet
+    uint8_t sequence;   // DDP: 1-15, 0 = unused. E1.31: 0-255
+    bool push;          // Frame complete (always true for E1.31)
+};
+
+/**
+ * Decode a DDP header from the first DDP_HEADER bytes of a @p packetLen
+ * byte packet. If `headerLen` grew by DDP_TIMECODE, skip those bytes.
+ * @return false for other versions or data types, or a truncated packet
+ */
+bool parseDdpHeader(const uint8_t *hdr, size_t packetLen, PixelPacket &out);
+
+/**
+ * Decode the first E131_HEADER bytes of a @p packetLen byte E1.31 data
+ * packet addressed to @p universe. Only DMX slot data (start code 0) is
+ * accepted.
+ * @return false for anything else, including other universes
+ */
+bool parseE131Header(const uint8_t *hdr, size_t packetLen, uint16_t universe,
+                     PixelPacket &out);
+
+/**
+ * Tracks packet sequence numbers that count up modulo @p modulus. Small
+ * steps forward are accepted and count the skipped numbers as lost; a
+ * number seen again or up to @p window behind the last one is rejected as
+ * late, as E1.31 receivers are required to do.
+ */
+class SequenceCheck {
+ public:
+    SequenceCheck(uint16_t modulus, uint16_t window);
+
+    /** @return false if the packet is a duplicate or arrived late */
+    bool accept(uint16_t seq);
+
+    /** Forget the last number, e.g. after the stream timed out. */
+    void reset() { valid_ = false; }
+
+    uint32_t lost() const { return lost_; }
+    uint32_t late() const { return late_; }
+
+ private:
+    uint16_t modulus_;
+    uint16_t window_;
+    uint16_t last_;
+    bool valid_;
+    uint32_t lost_;
+    uint32_t late_;
+};
+
+/**
+ * Multi-unit sync over ESP-NOW. The leader broadcasts its state and the
+ * animation phase of the running effect, stamped with its own clock, on
+ * every change and periodically as a clock beacon. Layout (little endian):
+ *   [magic][version][group][brightness][preset u16][stepMs u16]
+ *   [leader time ms u32][phase u32]
+ */
+constexpr uint8_t SYNC_MAGIC = 0x47;  // 'G'
+constexpr uint8_t SYNC_VERSION = 1;
+constexpr size_t SYNC_MESSAGE_SIZE = 16;
+
+enum class SyncRole : uint8_t {
+    OFF,
+    LEADER,
+    FOLLOWER
+};
+
+struct SyncMessage {
+    uint8_t group;      // Units only follow leaders of their own group
+    uint8_t brightness;
+    uint16_t preset;
+    uint16_t stepMs;
+    uint32_t time;      // Leader millis() when the message was sent
+    uint32_t phase;     // Leader animation phase at `time`
+};
+
+/** Write SYNC_MESSAGE_SIZE bytes at @p out. */
+void encodeSyncMessage(const SyncMessage &msg, uint8_t *out);
+
+/**
+ * Decode a sync message for @p group.
+ * @return false for a wrong size, magic, version or group
+ */
+bool decodeSyncMessage(const uint8_t *data, size_t len, uint8_t group,
+                       SyncMessage &msg);
+
+/**
+ * Estimates the offset between a remote clock and the local one from
+ * one-way timestamps. Transit delay only ever makes a message look older,
+ * so the sample with the least delay is kept; it is replaced by newer
+ * samples once older than @p windowMs so clock drift is followed.
+ */
+class ClockSync {
+ public:
+    explicit ClockSync(uint32_t windowMs);
+
+    /** Record a message stamped @p remote that arrived at @p local. */
+    void sample(uint32_t remote, uint32_t local);
+
+    void reset() { valid_ = false; }
+    bool valid() const { return valid_; }
+
+    /** Local time at which the remote clock read @p remote. */
+    uint32_t toLocal(uint32_t remote) const { return remote - offset_; }
+
+ private:
+    uint32_t windowMs_;
+    uint32_t offset_;     // remote - local of the best sample
+    uint32_t sampledAt_;  // Local time of the best sample
+    bool valid_;
+};
+
+/**
+ * Binary preset store: a header followed by `count` fixed-size records.
+ * Record layout for `ledCount` LEDs:
+ *   [type][r g b][name length][name, PRESET_NAME_MAX bytes]
+ *   [ledCount x r g b][ledCount effect bytes]
+ * Multi-byte header fields are little endian.
+ */
+constexpr uint32_t PRESET_STORE_MAGIC = 0x31535047UL;  // "GPS1"
+constexpr uint8_t PRESET_STORE_VERSION = 1;
+constexpr size_t PRESET_STORE_HEADER = 12;
+constexpr size_t PRESET_NAME_MAX = 31;
+
+constexpr size_t PRESET_REC_TYPE = 0;
+constexpr size_t PRESET_REC_COLOR = 1;
+constexpr size_t PRESET_REC_NAME_LEN = 4;
+constexpr size_t PRESET_REC_NAME = 5;
+constexpr size_t PRESET_REC_LEDS = PRESET_REC_NAME + PRESET_NAME_MAX;
+
+constexpr size_t presetRecordEffects(uint8_t ledCount) {
+    return PRESET_REC_LEDS + 3U * ledCount;
+}
+
+constexpr size_t presetRecordSize(uint8_t ledCount) {
+    return PRESET_REC_LEDS + 4U * ledCount;
+}
+
+/** Fill PRESET_STORE_HEADER bytes at @p out. */
+void writePresetStoreHeader(uint8_t *out, uint16_t count, uint8_t ledCount);
+
+/**
+ * Validate a store header.
+ * @return false for a wrong magic, version or record size
+ */
+bool readPresetStoreHeader(const uint8_t *in, size_t len, uint16_t &count,
+                           uint8_t &ledCount);
+
+/**
+ * Boot record: the last-used preset cached in NVS so the LEDs light up
+ * before the preset store is mounted. A header followed by one preset
+ * record for `ledCount` LEDs:
+ *   [magic][version][ledCount][brightness][preset u16][stepMs u16]
+ * Multi-byte fields are little endian.
+ */
+constexpr uint8_t BOOT_RECORD_MAGIC = 0x42;  // 'B'
+constexpr uint8_t BOOT_RECORD_VERSION = 1;
+constexpr size_t BOOT_RECORD_HEADER = 8;
+
+struct BootState {
+    uint16_t preset;     // Index into the preset list
+    uint8_t brightness;
+    uint16_t stepMs;
+};
+
+/** Fill BOOT_RECORD_HEADER bytes at @p out. */
+void writeBootRecordHeader(uint8_t *out, const BootState &st,
+                           uint8_t ledCount);
+
+/**
+ * Validate a boot record of @p len bytes, including the preset record.
+ * @return false for a wrong magic, version, LED count or size
+ */
+bool readBootRecordHeader(const uint8_t *in, size_t len, uint8_t ledCount,
+                          BootState &st);
+
+/**
+ * Literal template text followed by a placeholder. `marker` indexes the
+ * marker list passed to splitTemplate(), or is -1 for the final segment.
+ */
+struct TemplateSegment {
+    const char *text;
+    size_t len;
+    int marker;
+};
+
+/**
+ * Split @p tpl at `%NAME%` placeholders without copying it, so the pieces
+ * can be streamed with the placeholders filled in between. Unknown
+ * `%...%` sequences are kept as literal text.
+ * @return number of segments written, or 0 if @p maxSegments is too small
+ */
+size_t splitTemplate(const char *tpl, const char *const *markers,
+                     size_t markerCount, TemplateSegment *out,
+                     size_t maxSegments);
+
+/** State pushed to WebSocket clients whenever any field changes. */
+struct StateSnapshot {
+    int32_t preset;
+    int32_t hold;
+    uint8_t bright;
+    uint32_t speed;
+    uint32_t color;       // 0xRRGGBB of the active preset
+    uint16_t presetCount;
+    bool live;
+};
+
+// Longest message formatStateDelta() produces, including the terminator
+constexpr size_t STATE_DELTA_MAX = 128;
+
+/**
+ * Format the fields of @p cur that differ from @p prev as a JSON object,
+ * e.g. `{"preset":2,"color":"#ff0000"}`. A null @p prev formats all fields.
+ * @return message length, or 0 if nothing changed or it does not fit
+ */
+size_t formatStateDelta(const StateSnapshot *prev, const StateSnapshot &cur,
+                        char *out, size_t outSize);
+
+/**
+ * Binary form of a StateSnapshot for the BLE state characteristic, small
+ * enough for one notification at the default ATT MTU. Layout (little
+ * endian, 0xFFFF for no preset or hold, speed saturated at 0xFFFF):
+ *   [preset u16][hold u16][bright][speed u16][r][g][b][count u16][flags]
+ * Flag bit 0 is set while a live stream is shown.
+ */
+constexpr size_t STATE_RECORD_SIZE = 13;
+constexpr uint8_t STATE_FLAG_LIVE = 0x01;
+
+/** Write STATE_RECORD_SIZE bytes at @p out. */
+void encodeStateRecord(const StateSnapshot &st, uint8_t *out);
+
+/**
+ * Escape @p in for use inside a JSON string literal (without the quotes).
+ * The output is always NUL terminated and truncated only between whole
+ * escape sequences.
+ * @return number of characters written, excluding the terminator
+ */
+size_t jsonEscape(const char *in, char *out, size_t outSize);
+
+/**
+ * Collects bytes from a stream into newline-terminated lines without
+ * blocking. Leading and trailing whitespace is dropped and lines longer
+ * than CAPACITY - 1 characters are discarded up to the next newline.
+ */
+class LineAssembler {
+ public:
+    static const size_t CAPACITY = 128;
+
+    LineAssembler();
+
+    /**
+     * Append one byte.
+     * @return true when a complete, non-empty line is available via line()
+     *         until the next call to push()
+     */
+    bool push(char c);
+
+    /** NUL-terminated line, valid after push() returned true. */
+    const char *line() const { return buf_; }
+    size_t length() const { return len_; }
+
+ private:
+    char buf_[CAPACITY];
+    size_t len_;
+    bool overflow_;
+    bool ready_;
+};
+
+/**
+ * Incremental parser for the header of a gzip member (RFC 1952), so
+ * compressed uploads can be inflated as they arrive. Optional fields are
+ * skipped; only deflate with no reserved flags is accepted.
+ */
+class GzipHeader {
+ public:
+    enum Status : uint8_t {
+        MORE,     // all bytes consumed, the header continues
+        DONE,     // header complete, deflate data follows
+        INVALID
+    };
+
+    GzipHeader();
+
+    /**
+     * Consume header bytes from @p data. On DONE @p used tells where the
+     * deflate data starts; otherwise all @p len bytes were consumed.
+     */
+    Status feed(const uint8_t *data, size_t len, size_t &used);
+
+ private:
+    enum Field : uint8_t { FIXED, EXTRA_LEN, EXTRA, NAME, COMMENT, HCRC, END };
+
+    void next();
+
+    Field field_;
+    uint8_t flags_;
+    uint16_t remaining_;  // Bytes left in a fixed size field
+    uint8_t extraLen_;    // Low byte of XLEN
+    bool invalid_;
+};
+
+// gzip trailer: CRC-32 and size modulo 2^32 of the uncompressed data
+constexpr size_t GZIP_TRAILER = 8;
+
+/** True if @p trailer matches @p crc and @p size of the inflated data. */
+bool checkGzipTrailer(const uint8_t *trailer, uint32_t crc, uint32_t size);
+
+/**
+ * Continue the CRC-32 (as used by gzip and zlib) @p crc over @p len bytes.
+ * Start from 0.
+ */
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len);
@@ -0,0 +1,43 @@
+#pragma once
+// Copyright 2025 Bootj05
+#include <stdint.h>
+
+/**
+ * Decides when state changed in RAM is written back to flash.
+ *
+ * A write is due once no change arrived for `quietMs`, so a burst of
+ * slider moves costs a single write. A steady stream of changes still
+ * gets saved `maxDelayMs` after the first unsaved one.
+ */
+class WriteBehind {
+ public:
+  WriteBehind(uint32_t quietMs, uint32_t maxDelayMs)
+      : quiet_(quietMs), maxDelay_(maxDelayMs), dirty_(false), first_(0),
+        last_(0) {}
+
+  /** Record a change made at @p now. */
+  void mark(uint32_t now) {
+    if (!dirty_) {
+      dirty_ = true;
+      first_ = now;
+    }
+    last_ = now;
+  }
+
+  bool dirty() const { return dirty_; }
+
+  /** Whether the pending changes should be written at @p now. */
+  bool due(uint32_t now) const {
+    return dirty_ && (now - last_ >= quiet_ || now - first_ >= maxDelay_);
+  }
+
+  /** Call once the changes were written. */
+  void clear() { dirty_ = false; }
+
+ private:
+  uint32_t quiet_;
+  uint32_t maxDelay_;
+  bool dirty_;
+  uint32_t first_;  // First change since the last write
+  uint32_t last_;   // Most recent change
+};
@@ -0,0 +1,108 @@
+"""Gzip the web UI in web/ into a header of PROGMEM arrays.
+
+Runs as a PlatformIO pre-build script for the firmware environments. The
+header is written to the build directory and only rewritten when the
+assets change. It can also be run by hand:
+
+    python scripts/embed_web.py web out/web_assets.h
+"""
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".json": "application/json",
+}
+
+
+def symbol(rel):
+    return "WEB_" + re.sub(r"[^A-Za-z0-9]", "_", rel).upper()
+
+
+def render(source_dir):
+    names = []
+    for root, _, files in os.walk(source_dir):
+        for name in files:
+            path = os.path.join(root, name)
+            rel = os.path.relpath(path, source_dir).replace(os.sep, "/")
+            if os.path.splitext(name)[1] in MIME_TYPES:
+                names.append(rel)
+    names.sort()
+
+    lines = [
+        "#pragma once",
+        "// Generated by scripts/embed_web.py from web/. Do not edit.",
+        "#include <pgmspace.h>",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "struct WebAsset {",
+        "  const char *path;",
+        "  const char *type;",
+        "  const char *etag;",
+        "  const uint8_t *data;",
+        "  size_t len;",
+        "};",
+        "",
+    ]
+    entries = []
+    for rel in names:
+        with open(os.path.join(source_dir, rel), "rb") as f:
+            raw = f.read()
+        # mtime=0 keeps the output, and therefore the ETag, reproducible
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '\\"%s\\"' % hashlib.sha1(raw).hexdigest()[:16]
+        sym = symbol(rel)
+        lines.append("const uint8_t %s[] PROGMEM = {" % sym)
+        for i in range(0, len(data), 16):
+            chunk = data[i:i + 16]
+            lines.append("  " + ", ".join("0x%02x" % b for b in chunk) + ",")
+        lines.append("};")
+        url = "/" if rel == "index.html" else "/" + rel
+        mime = MIME_TYPES[os.path.splitext(rel)[1]]
+        entries.append('  {"%s", "%s", "%s", %s, sizeof(%s)},'
+                       % (url, mime, etag, sym, sym))
+    lines.append("")
+    lines.append("const WebAsset WEB_ASSETS[] = {")
+    lines.extend(entries)
+    lines.append("};")
+    lines.append("constexpr size_t WEB_ASSET_COUNT = %d;" % len(entries))
+    return "\n".join(lines) + "\n"
+
+
+def generate(source_dir, out_path):
+    text = render(source_dir)
+    try:
+        with open(out_path) as f:
+            if f.read() == text:
+                return
+    except IOError:
+        pass
+    out_dir = os.path.dirname(out_path)
+    if out_dir and not os.path.isdir(out_dir):
+        os.makedirs(out_dir)
+    with open(out_path, "w") as f:
+        f.write(text)
+    print("embed_web: wrote %s" % out_path)
+
+
+try:
+    Import("env")  # noqa: F821
+except NameError:
+    env = None
+
+if env is not None:
+    project = env.subst("$PROJECT_DIR")
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "web")
+    generate(os.path.join(project, "web"),
+             os.path.join(out_dir, "web_assets.h"))
+    env.Append(CPPPATH=[out_dir])
+elif __name__ == "__main__":
+    generate(sys.argv[1], sys.argv[2])
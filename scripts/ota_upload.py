@@ -0,0 +1,37 @@
+"""Upload firmware to the /update page as a gzip-compressed image.
+
+The firmware inflates the image while writing it, so only about half the
+bytes cross the network. Used as the upload command of the esp32-ota
+environment; it can also be run by hand:
+
+    python scripts/ota_upload.py .pio/build/esp32-ota/firmware.bin <host>
+"""
+import gzip
+import sys
+import urllib.request
+import uuid
+
+
+def upload(path, host):
+    with open(path, "rb") as f:
+        image = f.read()
+    data = gzip.compress(image, 9)
+    print("ota_upload: %d bytes, %d compressed" % (len(image), len(data)))
+    boundary = uuid.uuid4().hex
+    head = ("--%s\r\n"
+            "Content-Disposition: form-data; name=\"firmware\"; "
+            "filename=\"firmware.bin.gz\"\r\n"
+            "Content-Type: application/gzip\r\n\r\n" % boundary)
+    tail = "\r\n--%s--\r\n" % boundary
+    req = urllib.request.Request(
+        "http://%s/update" % host,
+        data=head.encode() + data + tail.encode(),
+        headers={"Content-Type": "multipart/form-data; boundary=" + boundary})
+    with urllib.request.urlopen(req, timeout=300) as resp:
+        reply = resp.read().decode().strip()
+    print("ota_upload: %s" % reply)
+    return reply == "OK"
+
+
+if __name__ == "__main__":
+    sys.exit(0 if upload(sys.argv[1], sys.argv[2]) else 1)
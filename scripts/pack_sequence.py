@@ -0,0 +1,53 @@
+"""Pack a JSON keyframe sequence into the binary format the firmware plays.
+
+The input lists keyframes with a duration and one color per LED:
+
+    {"loop": true,
+     "frames": [{"ms": 500, "leds": ["#ff0000", "#0000ff", ...]}, ...]}
+
+Each keyframe fades into the next over its duration. Upload the result
+with:
+
+    python scripts/pack_sequence.py show.json show.bin
+    curl -F file=@show.bin http://<device_ip>/sequence
+"""
+import json
+import struct
+import sys
+
+MAGIC = 0x53
+VERSION = 1
+FLAG_LOOP = 0x01
+
+
+def color(text):
+    text = text.lstrip("#")
+    if len(text) != 6:
+        raise ValueError("bad color %r" % text)
+    return bytes(bytearray.fromhex(text))
+
+
+def pack(seq):
+    frames = seq["frames"]
+    if not frames:
+        raise ValueError("a sequence needs at least one keyframe")
+    leds = len(frames[0]["leds"])
+    out = bytearray(struct.pack("<BBBBHH", MAGIC, VERSION,
+                                FLAG_LOOP if seq.get("loop") else 0, 0,
+                                leds, len(frames)))
+    for i, frame in enumerate(frames):
+        if len(frame["leds"]) != leds:
+            raise ValueError("keyframe %d has %d LEDs, expected %d" %
+                             (i, len(frame["leds"]), leds))
+        out += struct.pack("<H", frame["ms"])
+        for c in frame["leds"]:
+            out += color(c)
+    return bytes(out)
+
+
+if __name__ == "__main__":
+    with open(sys.argv[1]) as f:
+        data = pack(json.load(f))
+    with open(sys.argv[2], "wb") as f:
+        f.write(data)
+    print("pack_sequence: %d bytes" % len(data))
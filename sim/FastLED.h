@@ -0,0 +1,195 @@
+#pragma once
+// Copyright 2025 Bootj05
+//
+// Minimal stand-in for the parts of FastLED used by the effect engine, so
+// effects.cpp builds and runs on the host in the `native` env. The color
+// math follows FastLED 3.9 (hsv2rgb_rainbow, scale8 and random8) closely
+// enough for golden frames and benchmarks; it is not used on the device.
+#include <stddef.h>
+#include <stdint.h>
+
+inline uint8_t scale8(uint8_t i, uint8_t scale) {
+  return static_cast<uint8_t>((static_cast<uint16_t>(i) * (1 + scale)) >> 8);
+}
+
+inline uint8_t scale8_video(uint8_t i, uint8_t scale) {
+  return static_cast<uint8_t>(((static_cast<uint16_t>(i) * scale) >> 8) +
+                              ((i && scale) ? 1 : 0));
+}
+
+struct CHSV {
+  uint8_t hue;
+  uint8_t sat;
+  uint8_t val;
+
+  CHSV() : hue(0), sat(0), val(0) {}
+  CHSV(uint8_t h, uint8_t s, uint8_t v) : hue(h), sat(s), val(v) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+
+struct CRGB {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+
+  enum HTMLColorCode : uint32_t {
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    Green = 0x008000,
+    Orange = 0xFFA500,
+    Purple = 0x800080,
+    Red = 0xFF0000,
+    White = 0xFFFFFF,
+    Yellow = 0xFFFF00
+  };
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  CRGB(uint32_t code)  // NOLINT(runtime/explicit)
+      : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF) {}
+  CRGB(HTMLColorCode code)  // NOLINT(runtime/explicit)
+      : CRGB(static_cast<uint32_t>(code)) {}
+  CRGB(const CHSV &hsv) { hsv2rgb_rainbow(hsv, *this); }  // NOLINT
+
+  CRGB &operator=(const CHSV &hsv) {
+    hsv2rgb_rainbow(hsv, *this);
+    return *this;
+  }
+
+  /** Scale all channels by @p scale / 256, like FastLED's nscale8(). */
+  CRGB &nscale8(uint8_t scale) {
+    r = scale8(r, scale);
+    g = scale8(g, scale);
+    b = scale8(b, scale);
+    return *this;
+  }
+};
+
+inline bool operator==(const CRGB &a, const CRGB &b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+inline bool operator!=(const CRGB &a, const CRGB &b) { return !(a == b); }
+
+inline void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb) {
+  uint8_t hue = hsv.hue;
+  uint8_t sat = hsv.sat;
+  uint8_t val = hsv.val;
+  uint8_t offset8 = static_cast<uint8_t>((hue & 0x1F) << 3);
+  uint8_t third = scale8(offset8, 256 / 3);
+  uint8_t twothirds = scale8(offset8, (256 * 2) / 3);
+  uint8_t r, g, b;
+  switch (hue >> 5) {
+    case 0:  // R -> O
+      r = 255 - third;
+      g = third;
+      b = 0;
+      break;
+    case 1:  // O -> Y
+      r = 171;
+      g = 85 + third;
+      b = 0;
+      break;
+    case 2:  // Y -> G
+      r = 171 - twothirds;
+      g = 170 + third;
+      b = 0;
+      break;
+    case 3:  // G -> A
+      r = 0;
+      g = 255 - third;
+      b = third;
+      break;
+    case 4:  // A -> B
+      r = 0;
+      g = 171 - twothirds;
+      b = 85 + twothirds;
+      break;
+    case 5:  // B -> P
+      r = third;
+      g = 0;
+      b = 255 - third;
+      break;
+    case 6:  // P -> K
+      r = 85 + third;
+      g = 0;
+      b = 171 - third;
+      break;
+    default:  // K -> R
+      r = 170 + third;
+      g = 0;
+      b = 85 - third;
+      break;
+  }
+  if (sat != 255) {
+    if (sat == 0) {
+      r = g = b = 255;
+    } else {
+      uint8_t desat = scale8_video(255 - sat, 255 - sat);
+      uint8_t satscale = 255 - desat;
+      r = scale8(r, satscale) + desat;
+      g = scale8(g, satscale) + desat;
+      b = scale8(b, satscale) + desat;
+    }
+  }
+  if (val != 255) {
+    val = scale8_video(val, val);
+    r = scale8(r, val);
+    g = scale8(g, val);
+    b = scale8(b, val);
+  }
+  rgb.r = r;
+  rgb.g = g;
+  rgb.b = b;
+}
+
+inline void fill_solid(CRGB *leds, int count, const CRGB &color) {
+  for (int i = 0; i < count; ++i)
+    leds[i] = color;
+}
+
+inline void fill_rainbow(CRGB *leds, int count, uint8_t hue, uint8_t delta) {
+  CHSV hsv(hue, 240, 255);
+  for (int i = 0; i < count; ++i) {
+    leds[i] = hsv;
+    hsv.hue += delta;
+  }
+}
+
+/** Blend @p existing towards @p overlay by @p amount / 255 in place. */
+inline CRGB &nblend(CRGB &existing, const CRGB &overlay, uint8_t amount) {
+  if (amount == 0)
+    return existing;
+  if (amount == 255) {
+    existing = overlay;
+    return existing;
+  }
+  existing.r = scale8(existing.r, 255 - amount) + scale8(overlay.r, amount);
+  existing.g = scale8(existing.g, 255 - amount) + scale8(overlay.g, amount);
+  existing.b = scale8(existing.b, 255 - amount) + scale8(overlay.b, amount);
+  return existing;
+}
+
+// FastLED's 16 bit linear congruential generator
+inline uint16_t &rand16seed() {
+  static uint16_t seed = 1337;
+  return seed;
+}
+
+inline void random16_set_seed(uint16_t seed) { rand16seed() = seed; }
+
+inline uint8_t random8() {
+  uint16_t &seed = rand16seed();
+  seed = static_cast<uint16_t>(seed * 2053U + 13849U);
+  return static_cast<uint8_t>((seed & 0xFF) + (seed >> 8));
+}
+
+inline uint8_t random8(uint8_t lim) {
+  return static_cast<uint8_t>((random8() * lim) >> 8);
+}
+
+inline uint8_t random8(uint8_t min, uint8_t lim) {
+  return min + random8(lim - min);
+}
@@ -0,0 +1,348 @@
+// Copyright 2025 Bootj05
+//
+// Licensed under the MIT License.
+#include "effects.h"
+
+#include <string.h>
+
+namespace {
+
+// Timings in animation steps; the default 50 ms step gives the original
+// 250 ms flashes, 20 ms strobe and 150 ms pulses.
+constexpr uint32_t POLICE_NL_FLASH_STEPS = 5;
+constexpr uint32_t POLICE_NL_STROBE_TOGGLES = 5;  // Per two steps (20 ms)
+constexpr uint32_t POLICE_USA_PULSE_STEPS = 3;
+constexpr uint8_t POLICE_USA_PULSES = 3;
+// Largest gap between two renders fed into the clock
+constexpr uint32_t MAX_FRAME_GAP_MS = 60000;
+
+inline uint32_t wholeSteps(uint32_t phase) { return phase >> PHASE_SHIFT; }
+
+void initNone(EffectState &s, const EffectParams &, uint16_t count) {
+  s.count = count;
+}
+
+bool tickNever(EffectState &, uint32_t) { return false; }
+
+void renderStatic(const EffectState &, const EffectParams &p, CRGB *out,
+                  uint16_t count) {
+  fill_solid(out, count, p.color);
+}
+
+void initRainbow(EffectState &s, const EffectParams &, uint16_t count) {
+  s.count = count;
+  s.rainbow.hue = 0;
+}
+
+bool tickRainbow(EffectState &s, uint32_t phase) {
+  uint8_t hue = wholeSteps(phase);
+  if (hue == s.rainbow.hue)
+    return false;
+  s.rainbow.hue = hue;
+  return true;
+}
+
+void renderRainbow(const EffectState &s, const EffectParams &, CRGB *out,
+                   uint16_t count) {
+  fill_rainbow(out, count, s.rainbow.hue, 7);
+}
+
+// lut[i] is 1 for LEDs in groups 1 & 3 and 2 for groups 2 & 4. The groups
+// are the segments of the LED topology, e.g. one per lens; without
+// segments the LEDs are split in four, 0-2, 3-5, 6-8 and 9-12 for 13 LEDs.
+// LEDs outside every segment stay dark.
+void initPoliceNl(EffectState &s, const EffectParams &p, uint16_t count) {
+  s.count = count;
+  s.policeNl.phase = false;
+  s.policeNl.strobeOn = false;
+  s.policeNl.strobeGroup = 0;
+  s.policeNl.flashCount = 0;
+  if (p.segments && p.segmentCount) {
+    memset(s.lut, 0, count);
+    for (uint8_t g = 0; g < p.segmentCount; ++g) {
+      const LedSegment &seg = p.segments[g];
+      for (uint16_t i = seg.first; i < seg.first + seg.count && i < count; ++i)
+        s.lut[i] = (g % 2 == 0) ? 1 : 2;
+    }
+    return;
+  }
+  uint16_t groupSize = count >= 4 ? count / 4 : 1;
+  for (uint16_t i = 0; i < count; ++i) {
+    uint16_t group = i / groupSize;
+    if (group > 3)
+      group = 3;
+    s.lut[i] = (group % 2 == 0) ? 1 : 2;
+  }
+}
+
+// Every 20th flash strobes groups 1 & 3, ten flashes later groups 2 & 4.
+bool tickPoliceNl(EffectState &s, uint32_t phase) {
+  PoliceNlState &st = s.policeNl;
+  uint32_t flashCount = phase / (POLICE_NL_FLASH_STEPS * PHASE_ONE);
+  uint8_t strobeGroup = 0;
+  if (flashCount && flashCount % 20 == 0)
+    strobeGroup = 1;
+  else if (flashCount % 20 == 10)
+    strobeGroup = 2;
+  uint64_t halfPeriods = static_cast<uint64_t>(phase) *
+                         POLICE_NL_STROBE_TOGGLES / (2 * PHASE_ONE);
+  bool strobeOn = strobeGroup && halfPeriods % 2 == 0;
+  if (flashCount == st.flashCount && strobeOn == st.strobeOn)
+    return false;
+  st.flashCount = flashCount;
+  st.phase = flashCount % 2;
+  st.strobeGroup = strobeGroup;
+  st.strobeOn = strobeOn;
+  return true;
+}
+
+void renderPoliceNl(const EffectState &s, const EffectParams &, CRGB *out,
+                    uint16_t count) {
+  const PoliceNlState &st = s.policeNl;
+  uint8_t lit = st.strobeGroup ? st.strobeGroup : (st.phase ? 2 : 1);
+  bool on = !st.strobeGroup || st.strobeOn;
+  for (uint16_t i = 0; i < count; ++i) {
+    out[i] = (on && s.lut[i] == lit) ? CRGB::Blue : CRGB::Black;
+  }
+}
+
+// lut[i] is 0 for the left half, 1 for the center LED and 2 for the right
+// half. Even LED counts have no center.
+void initPoliceUsa(EffectState &s, const EffectParams &, uint16_t count) {
+  s.count = count;
+  s.policeUsa.step = 0;
+  uint16_t half = count / 2;
+  for (uint16_t i = 0; i < count; ++i) {
+    if (i < half)
+      s.lut[i] = 0;
+    else if (count % 2 && i == half)
+      s.lut[i] = 1;
+    else
+      s.lut[i] = 2;
+  }
+}
+
+bool tickPoliceUsa(EffectState &s, uint32_t phase) {
+  uint8_t step = (phase / (POLICE_USA_PULSE_STEPS * PHASE_ONE)) %
+                 (POLICE_USA_PULSES * 4);
+  if (step == s.policeUsa.step)
+    return false;
+  s.policeUsa.step = step;
+  return true;
+}
+
+void renderPoliceUsa(const EffectState &s, const EffectParams &, CRGB *out,
+                     uint16_t count) {
+  uint8_t step = s.policeUsa.step;
+  if (step % 2 != 0) {
+    fill_solid(out, count, CRGB::Black);
+    return;
+  }
+  bool left = (step / (POLICE_USA_PULSES * 2)) % 2 == 0;
+  const CRGB side[3] = {left ? CRGB(CRGB::Red) : CRGB(CRGB::Black),
+                        CRGB(CRGB::White),
+                        left ? CRGB(CRGB::Black) : CRGB(CRGB::Blue)};
+  for (uint16_t i = 0; i < count; ++i) {
+    out[i] = side[s.lut[i]];
+  }
+}
+
+void initStrobe(EffectState &s, const EffectParams &, uint16_t count) {
+  s.count = count;
+  s.strobe.on = false;
+}
+
+bool tickStrobe(EffectState &s, uint32_t phase) {
+  bool on = wholeSteps(phase) % 2;
+  if (on == s.strobe.on)
+    return false;
+  s.strobe.on = on;
+  return true;
+}
+
+void renderStrobe(const EffectState &s, const EffectParams &, CRGB *out,
+                  uint16_t count) {
+  fill_solid(out, count, s.strobe.on ? CRGB::White : CRGB::Black);
+}
+
+// lut[i] is the hue offset of LED i along the gradient
+void initLava(EffectState &s, const EffectParams &, uint16_t count) {
+  s.count = count;
+  s.lava.pos = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    s.lut[i] = (i * 10) % 255;
+  }
+}
+
+bool tickLava(EffectState &s, uint32_t phase) {
+  uint8_t pos = wholeSteps(phase);
+  if (pos == s.lava.pos)
+    return false;
+  s.lava.pos = pos;
+  return true;
+}
+
+// FIRE, CANDLE and PARTY draw new random values once per step
+void initRandom(EffectState &s, const EffectParams &, uint16_t count) {
+  s.count = count;
+  s.random.step = 0;
+}
+
+bool tickRandom(EffectState &s, uint32_t phase) {
+  uint32_t step = wholeSteps(phase);
+  if (step == s.random.step)
+    return false;
+  s.random.step = step;
+  return true;
+}
+
+void renderLava(const EffectState &s, const EffectParams &, CRGB *out,
+                uint16_t count) {
+  for (uint16_t i = 0; i < count; ++i) {
+    out[i] = CHSV((s.lava.pos + s.lut[i]) % 255, 200, 255);
+  }
+}
+
+void renderFire(const EffectState &, const EffectParams &, CRGB *out,
+                uint16_t count) {
+  for (uint16_t i = 0; i < count; ++i) {
+    out[i] = CHSV(random8(0, 40), 255, random8(120, 255));
+  }
+}
+
+void renderCandle(const EffectState &, const EffectParams &, CRGB *out,
+                  uint16_t count) {
+  uint8_t bri = random8(150, 255);
+  CRGB color = CHSV(random8(25, 45), 200, bri);
+  fill_solid(out, count, color);
+}
+
+void renderParty(const EffectState &, const EffectParams &, CRGB *out,
+                 uint16_t count) {
+  for (uint16_t i = 0; i < count; ++i) {
+    out[i] = CHSV(random8(), 255, 255);
+  }
+}
+
+void renderCustom(const EffectState &, const EffectParams &p, CRGB *out,
+                  uint16_t count) {
+  uint16_t n = p.leds ? (p.ledCount < count ? p.ledCount : count) : 0;
+  for (uint16_t i = 0; i < n; ++i) {
+    out[i] = p.leds[i];
+  }
+  if (n < count)
+    fill_solid(out + n, count - n, CRGB::Black);
+}
+
+// Indexed by PresetType; keep in declaration order.
+const Effect EFFECTS[PRESET_TYPE_COUNT] = {
+    {initNone, tickNever, renderStatic, false},             // STATIC
+    {initRainbow, tickRainbow, renderRainbow, true},        // RAINBOW
+    {initPoliceNl, tickPoliceNl, renderPoliceNl, true},     // POLICE_NL
+    {initPoliceUsa, tickPoliceUsa, renderPoliceUsa, true},  // POLICE_USA
+    {initStrobe, tickStrobe, renderStrobe, true},           // STROBE
+    {initLava, tickLava, renderLava, true},                 // LAVALAMP
+    {initRandom, tickRandom, renderFire, true},             // FIRE
+    {initRandom, tickRandom, renderCandle, true},           // CANDLE
+    {initRandom, tickRandom, renderParty, true},            // PARTY
+    {initNone, tickNever, renderCustom, false},             // CUSTOM
+};
+
+}  // namespace
+
+const Effect &effectFor(PresetType type) {
+  size_t idx = static_cast<size_t>(type);
+  return EFFECTS[idx < PRESET_TYPE_COUNT ? idx : 0];
+}
+
+uint8_t crossfadeAmount(uint32_t elapsed, uint32_t duration) {
+  if (duration == 0 || elapsed >= duration)
+    return 255;
+  return static_cast<uint8_t>((static_cast<uint64_t>(elapsed) * 255) /
+                              duration);
+}
+
+void crossfade(const CRGB *from, const CRGB *to, uint8_t amount, CRGB *out,
+               uint16_t count) {
+  for (uint16_t i = 0; i < count; ++i) {
+    out[i] = from[i];
+    nblend(out[i], to[i], amount);
+  }
+}
+
+uint32_t extrapolatePhase(uint32_t phase, int32_t elapsed, uint32_t stepMs) {
+  if (stepMs == 0)
+    stepMs = 1;
+  int64_t steps = static_cast<int64_t>(elapsed) * PHASE_ONE / stepMs;
+  return phase + static_cast<uint32_t>(steps);
+}
+
+EffectEngine::EffectEngine()
+    : type_(PresetType::STATIC),
+      effect_(&effectFor(PresetType::STATIC)),
+      params_(),
+      state_(),
+      dirty_(true),
+      started_(false),
+      lastNow_(0),
+      phase_(0),
+      phaseRemainder_(0) {
+  state_.count = UINT16_MAX;
+}
+
+void EffectEngine::activate(PresetType type, const EffectParams &params) {
+  type_ = type;
+  effect_ = &effectFor(type);
+  params_ = params;
+  state_.count = UINT16_MAX;  // forces init() on the next render
+  dirty_ = true;
+  started_ = false;
+  phase_ = 0;
+  phaseRemainder_ = 0;
+}
+
+void EffectEngine::advance(uint32_t now) {
+  if (!started_) {
+    lastNow_ = now;
+    started_ = true;
+    return;
+  }
+  uint32_t dt = now - lastNow_;
+  lastNow_ = now;
+  if (dt > MAX_FRAME_GAP_MS)
+    dt = MAX_FRAME_GAP_MS;
+  uint32_t stepMs = params_.stepMs ? params_.stepMs : 1;
+  // Carry the remainder so odd step lengths don't drift
+  uint32_t scaled = dt * PHASE_ONE + phaseRemainder_;
+  phase_ += scaled / stepMs;
+  phaseRemainder_ = scaled % stepMs;
+}
+
+void EffectEngine::syncPhase(uint32_t phase, uint32_t now) {
+  phase_ = phase;
+  phaseRemainder_ = 0;
+  lastNow_ = now;
+  started_ = true;
+}
+
+void EffectEngine::setParams(const EffectParams &params) {
+  params_ = params;
+  dirty_ = true;
+}
+
+bool EffectEngine::render(CRGB *out, uint16_t count, uint32_t now) {
+  uint16_t n = count > EFFECT_MAX_LEDS ? EFFECT_MAX_LEDS : count;
+  if (state_.count != n) {
+    effect_->init(state_, params_, n);
+    dirty_ = true;
+  }
+  advance(now);
+  bool changed = effect_->tick(state_, phase_);
+  if (!changed && !dirty_)
+    return false;
+  effect_->render(state_, params_, out, n);
+  if (n < count)
+    fill_solid(out + n, count - n, CRGB::Black);
+  dirty_ = false;
+  return true;
+}
@@ -5,8 +5,11 @@
 // Copyright 2025 Bootj05
 #include <ctype.h>
 #include <pgmspace.h>
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <algorithm>
@@ -18,25 +21,106 @@
 #include <WebServer.h>
 #include <WebSocketsServer.h>
 #include <WiFi.h>
+#include <WiFiUdp.h>
 #include <SPIFFS.h>
 #include <Preferences.h>
+#ifdef USE_BLE
+#include <NimBLEDevice.h>
+#else
 #include <BluetoothSerial.h>
+#endif
 #include <Update.h>
+#include <esp_now.h>
+#include <esp_partition.h>
+#include <esp32/rom/miniz.h>
 
 #include "secrets.h"  // NOLINT(build/include_subdir)
+#include "debounce.h"
+#include "double_buffer.h"
+#include "effects.h"
+#include "sequence.h"
+#include "spsc_queue.h"
+#include "stage_stats.h"
+#include "topology.h"
 #include "utils.h"
-
-#ifndef KEEP_NAMES_IN_FLASH
-#define KEEP_NAMES_IN_FLASH 0
-#endif
+#include "web_assets.h"
+#include "write_behind.h"
 
 namespace cfg {
-  constexpr uint8_t LED_PIN = 2;
-  constexpr uint8_t NUM_LEDS = 13;
+  // Strips, pins and segments are described in topology.h
+  static_assert(topology::LED_COUNT <= UINT8_MAX,
+                "the preset store records at most 255 LEDs");
+  constexpr uint8_t NUM_LEDS = topology::LED_COUNT;
   constexpr uint8_t BTN_PREV = 0;
   constexpr uint8_t BTN_NEXT = 35;
   // When held this button temporarily activates a user-selected preset
   constexpr uint8_t BTN_HOLD = 17;
+  // WiFi gives up on one attempt after this long
+  constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 15000;
+  // Reconnect delays start here and double up to the maximum
+  constexpr uint32_t WIFI_RETRY_MIN_MS = 500;
+  constexpr uint32_t WIFI_RETRY_MAX_MS = 60000;
+  // Time given to an HTTP response before a requested restart
+  constexpr uint32_t RESTART_DELAY_MS = 1000;
+  // Idle power saving starts once nothing changed for this long
+  constexpr uint32_t IDLE_AFTER_MS = 10000;
+  // Control changes and state broadcasts are paced by the frame period,
+  // but never held back longer than one 60 fps frame
+  constexpr uint32_t CONTROL_MAX_MS = 16;
+  constexpr uint32_t IDLE_CPU_MHZ = 80;
+  constexpr uint32_t ACTIVE_CPU_MHZ = 240;
+  // Longest loop() sleep while idle; buttons wake it immediately
+  constexpr uint32_t IDLE_LOOP_MS = 20;
+  // Default crossfade between presets; change at runtime with fade:<ms>
+  constexpr uint32_t FADE_MS = 300;
+  // Edges within this window of an accepted button change are bounce
+  constexpr uint32_t DEBOUNCE_MS = 50;
+  // The render task shares the application core with loop(), which runs
+  // the WebSocket, UDP, Bluetooth and OTA handlers, but at a higher
+  // priority than loopTask so frames go out on time. Only the WiFi stack
+  // and the HTTP task run on the protocol core.
+  constexpr BaseType_t RENDER_CORE = 1;
+  constexpr UBaseType_t RENDER_PRIORITY = 3;
+  constexpr uint32_t RENDER_STACK = 4096;
+  // The HTTP server runs in its own task on the protocol core so a slow
+  // client or an upload never holds up loop()
+  constexpr BaseType_t HTTP_CORE = 0;
+  constexpr UBaseType_t HTTP_PRIORITY = 1;
+  constexpr uint32_t HTTP_STACK = 6144;
+  constexpr uint32_t HTTP_POLL_MS = 2;
+  // Upper bound on Bluetooth bytes consumed per loop() iteration
+  constexpr int BT_BYTES_PER_LOOP = 64;
+  // BLE: MTU offered to centrals and the longest write accepted, which is
+  // what fits in one write at that MTU; longer LED frames are split by start
+  constexpr uint16_t BLE_MTU = 247;
+  constexpr size_t BLE_WRITE_MAX = BLE_MTU - 3;
+  // Fall back to the active preset when streamed frames stop arriving
+  constexpr uint32_t LIVE_TIMEOUT_MS = 2500;
+  // E1.31 universe carrying our pixels; 13 LEDs fit in one
+  constexpr uint16_t E131_UNIVERSE = 1;
+  // Upper bound on UDP pixel packets consumed per socket and loop()
+  constexpr int UDP_PACKETS_PER_LOOP = 8;
+  // Data partition holding the keyframe sequence, see partitions.csv
+  constexpr char SEQUENCE_LABEL[] = "sequence";
+  constexpr uint8_t SEQUENCE_SUBTYPE = 0x40;
+  // Units only follow a sync leader of the same group
+  constexpr uint8_t SYNC_GROUP = 0;
+  // A leader repeats its state this often as a clock beacon
+  constexpr uint32_t SYNC_BEACON_MS = 100;
+  // Followers run on their own clock again after this much silence
+  constexpr uint32_t SYNC_TIMEOUT_MS = 1000;
+  // Age after which the best clock sample gives way to newer ones
+  constexpr uint32_t SYNC_CLOCK_WINDOW_MS = 2000;
+  // Preset changes are written once no new change arrived for this long
+  constexpr uint32_t PRESET_SAVE_DELAY_MS = 3000;
+  // Settings are written once unchanged for SETTINGS_QUIET_MS, and no
+  // later than SETTINGS_MAX_DELAY_MS after the first unsaved change
+  constexpr uint32_t SETTINGS_QUIET_MS = 3000;
+  constexpr uint32_t SETTINGS_MAX_DELAY_MS = 30000;
+  // Journal entries allowed before the preset file is rewritten
+  constexpr size_t JOURNAL_MAX_ENTRIES = 32;
+  // Bytes collected before a chunk of a streamed page is sent
+  constexpr size_t HTTP_CHUNK_SIZE = 512;
   const char *SSID = WIFI_SSID;
   const char *PASSWORD = WIFI_PASSWORD;
 #ifdef USE_AUTH
@@ -45,69 +129,39 @@ namespace cfg {
 }  // namespace cfg
 
 /**
- * Types of LED animations.
- *
- * - `STATIC` &mdash; Solid color chosen per preset.
- * - `RAINBOW` &mdash; Continuously cycling rainbow.
- * - `POLICE_NL` &mdash; Segmented blue pattern with timed strobe like Dutch police lights.
- * - `POLICE_USA` &mdash; Red, white and blue pattern similar to US police lights.
- * - `STROBE` &mdash; Fast white flash on and off.
- * - `LAVALAMP` &mdash; Slowly moving color gradient.
- * - `FIRE`       Randomized warm flicker
- * - `CANDLE`     Single warm flickering glow
- * - `PARTY`      Random bright colors
- * - `CUSTOM`     Per-LED colors stored from the client
+ * A selectable preset. The layout has a fixed size and owns no heap memory,
+ * so presets can be copied and moved around the `presets` vector cheaply.
+ * Built-in presets point at their name in flash instead of copying it.
  */
-enum class PresetType {
-  STATIC,
-  RAINBOW,
-  POLICE_NL,
-  POLICE_USA,
-  STROBE,
-  LAVALAMP,
-  FIRE,
-  CANDLE,
-  PARTY,
-  CUSTOM
-};
 struct Preset {
-#if KEEP_NAMES_IN_FLASH
-  const __FlashStringHelper *flashName = nullptr;
-#endif
-  String name;
+  const __FlashStringHelper *flashName;  // Built-in name, or nullptr
+  char name[PRESET_NAME_MAX + 1];        // User name when flashName is unset
   PresetType type;
-  CRGB color;               // Only for STATIC
-  std::vector<CRGB> leds;        // Only for CUSTOM
-  std::vector<uint8_t> effects;  // Optional per-LED effect
+  CRGB color;                                 // Only for STATIC
+  std::array<CRGB, cfg::NUM_LEDS> leds;       // Only for CUSTOM
+  std::array<uint8_t, cfg::NUM_LEDS> effects;  // Optional per-LED effect
 
   Preset()
-      : name(),
+      : flashName(nullptr),
+        name(),
         type(PresetType::STATIC),
-        color(CRGB::Black),
-        leds(),
-        effects() {}
-
-  Preset(const String &n, PresetType t, CRGB c)
-      : name(n),
-        type(t),
-        color(c),
-        leds(),
-        effects() {
-    if (t == PresetType::CUSTOM) {
-      leds.assign(cfg::NUM_LEDS, CRGB::Black);
-      effects.assign(cfg::NUM_LEDS, 0);
-    }
+        color(CRGB::Black) {
+    leds.fill(CRGB::Black);
+    effects.fill(0);
   }
 
-  Preset(const Preset &other) = default;
-
-  Preset &operator=(const Preset &other) = default;
-
-  Preset(Preset &&other) noexcept = default;
-
-  Preset &operator=(Preset &&other) noexcept = default;
+  /** Copy a user name, truncated to PRESET_NAME_MAX characters */
+  void setName(const char *n, size_t len) {
+    len = std::min<size_t>(len, PRESET_NAME_MAX);
+    memcpy(name, n, len);
+    name[len] = '\0';
+    flashName = nullptr;
+  }
 
-  ~Preset() = default;
+  /** Name to display; flash is memory mapped on the ESP32 */
+  const char *displayName() const {
+    return flashName ? reinterpret_cast<const char *>(flashName) : name;
+  }
 };
 
 struct PresetData {
@@ -138,545 +192,1400 @@ const size_t DEFAULT_PRESET_COUNT =
 
 constexpr char DEFAULT_HOST[] = "JohannesBril";
 
+// Indices into `presets` with changes not yet written to flash
+std::vector<size_t> dirtyPresets;
+uint32_t lastPresetChange = 0;
+size_t journalEntries = 0;
+
 
 CRGB leds[cfg::NUM_LEDS];
+
+/**
+ * Everything the render task needs to draw a frame. The control path fills
+ * this from the preset list and publishes it through a DoubleBuffer so the
+ * render task never touches `presets`, `currentPreset` or `brightness`.
+ */
+struct RenderState {
+  int preset = 0;
+  PresetType type = PresetType::STATIC;
+  CRGB color = CRGB::Black;
+  CRGB leds[cfg::NUM_LEDS];
+  uint8_t brightness = 255;
+  uint32_t stepMs = 50;   // Animation time base
+  uint32_t frameMs = 20;  // Render period
+  uint32_t fadeMs = 0;    // Crossfade on preset switches, 0 = hard cut
+  SequenceInfo sequence;  // Played while preset is SEQUENCE_PRESET
+  uint32_t sequenceRun = 0;  // Changes to restart the sequence
+};
+
+DoubleBuffer<RenderState> renderState;
+TaskHandle_t renderTaskHandle = nullptr;
+// Task running loop(); woken from the button interrupt while idle
+TaskHandle_t loopTaskHandle = nullptr;
+
+/**
+ * Profiled stages. The render task records RENDER and SHOW on its own
+ * core; readers on the other core may see a sample in progress, which is
+ * accepted for statistics.
+ */
+enum Stage : uint8_t {
+  STAGE_LOOP,
+  STAGE_WIFI,
+  STAGE_BUTTONS,
+  STAGE_HTTP,
+  STAGE_WS,
+  STAGE_UDP,
+  STAGE_SYNC,
+  STAGE_BLUETOOTH,
+  STAGE_APPLY,
+  STAGE_PERSIST,
+  STAGE_BROADCAST,
+  STAGE_RENDER,
+  STAGE_SHOW,
+  STAGE_COUNT
+};
+const char *const STAGE_NAMES[STAGE_COUNT] = {
+    "loop", "wifi", "buttons", "http", "ws", "udp",
+    "sync", "bluetooth", "apply", "persist", "broadcast", "render", "show"};
+StageStats stageStats[STAGE_COUNT];
+std::atomic<uint32_t> framesRendered(0);
+std::atomic<uint32_t> framesShown(0);
+// Frames whose work overran the frame interval
+std::atomic<uint32_t> framesLate(0);
+// Converts cycle counts to microseconds; follows the power manager
+uint32_t cpuMhz = 240;
+// Copy of the last frame sent to the strip, used to skip redundant shows
+CRGB shownLeds[cfg::NUM_LEDS];
+uint8_t shownBrightness = 0;
+bool frameShown = false;
+EffectEngine engine;
+// Preset switches crossfade from the outgoing effect, which keeps running
+// in fadeEngine; both render into scratch buffers that are blended into
+// leds. Owned by the render task.
+EffectEngine fadeEngine;
+CRGB fadeFrom[cfg::NUM_LEDS];
+CRGB fadeTo[cfg::NUM_LEDS];
+
+// Phase of the running effect as of its last frame; sync leaders send it
+// in their beacons
+struct PhaseSample {
+  int preset = 0;
+  uint32_t phase = 0;
+  uint32_t time = 0;
+};
+DoubleBuffer<PhaseSample> renderPhase;
+
+// Leader phase a sync follower locks its effect to instead of running on
+// its own clock
+struct SyncTarget {
+  bool active = false;
+  int preset = 0;
+  uint32_t phase = 0;
+  uint32_t time = 0;    // Local millis() at which the leader had `phase`
+  uint32_t stepMs = 50;
+};
+DoubleBuffer<SyncTarget> syncTarget;
+
 int currentPreset = 0;
 // Index of the preset triggered when BTN_HOLD is pressed
 int holdPreset = 0;
 // Previous preset to restore after releasing BTN_HOLD
 int savedPreset = -1;
-uint8_t rainbowHue = 0;
-
-uint32_t lastAnim = 0;
 uint8_t brightness = 255;
+// Colors streamed over binary WebSocket frames. While live mode is active
+// they replace the active preset's output but are never persisted.
+CRGB liveLeds[cfg::NUM_LEDS];
+bool liveActive = false;
+uint32_t liveLastFrame = 0;
+// Keyframe sequence, read in place from its memory-mapped partition. Like
+// live frames it replaces the active preset until another one is chosen.
+const esp_partition_t *sequencePartition = nullptr;
+const uint8_t *sequenceData = nullptr;
+SequenceInfo storedSequence;  // frames is null without a valid sequence
+bool sequenceActive = false;
+uint32_t sequenceRuns = 0;
+// Sequence upload progress; only touched by the HTTP task
+uint8_t sequenceHeader[SEQUENCE_HEADER];
+size_t sequenceReceived = 0;
+size_t sequenceErased = 0;
+bool sequenceUploadOk = false;
+// Realtime pixel input over UDP, written straight into liveLeds
+WiFiUDP ddpUdp;
+WiFiUDP e131Udp;
+// DDP numbers packets 1-15 and uses 0 when it does not number them
+SequenceCheck ddpSequence(15, 4);
+SequenceCheck e131Sequence(256, 19);
+uint32_t udpPackets = 0;
+// Packets that were malformed, for another universe or out of range
+uint32_t udpDropped = 0;
+
+// Multi-unit sync over ESP-NOW broadcasts
+const uint8_t SYNC_BROADCAST[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF,
+                                                  0xFF, 0xFF, 0xFF};
+struct SyncPacket {
+  uint8_t data[SYNC_MESSAGE_SIZE];
+  uint8_t len;
+  uint32_t received;  // Stamped on arrival, before any queueing delay
+};
+// Filled by the ESP-NOW receive callback in the WiFi task
+SpscQueue<SyncPacket, 8> syncPackets;
+SyncRole syncRole = SyncRole::OFF;
+bool syncStarted = false;
+wifi_interface_t syncPeerIf = WIFI_IF_STA;
+ClockSync syncClock(cfg::SYNC_CLOCK_WINDOW_MS);
+// Leader: state of the last message sent
+SyncMessage syncSent;
+bool syncSentValid = false;
+uint32_t syncLastSend = 0;
+// Follower: last message adopted from the leader
+SyncMessage syncReceived;
+bool syncReceivedValid = false;
+uint32_t syncLastReceive = 0;
+// Render state preset id used for streamed frames
+constexpr int LIVE_PRESET = -1;
+// Render state preset id used while the keyframe sequence plays
+constexpr int SEQUENCE_PRESET = -2;
+// Command replies addressed to this id go to the Bluetooth peer
+constexpr int REPLY_BLUETOOTH = -1;
+
+// Duration of one animation step; sets how fast effects move
 uint32_t animInterval = 50;
+// Time between rendered frames; sets how smooth effects look
+uint32_t frameInterval = 20;
+// Duration of the crossfade between presets
+uint32_t fadeInterval = cfg::FADE_MS;
+
+/** Minimum time between two control applies or state broadcasts */
+uint32_t controlInterval() {
+  return std::min(frameInterval, cfg::CONTROL_MAX_MS);
+}
+
+// Buttons report timestamped edges from their interrupt handler
+enum ButtonId : uint8_t { BUTTON_PREV, BUTTON_NEXT, BUTTON_HOLD, BUTTON_COUNT };
+const uint8_t BUTTON_PINS[BUTTON_COUNT] = {cfg::BTN_PREV, cfg::BTN_NEXT,
+                                           cfg::BTN_HOLD};
+struct ButtonEvent {
+  uint8_t button;
+  bool pressed;
+  uint32_t time;
+};
+SpscQueue<ButtonEvent, 16> buttonEvents;
+// Set when the queue was full; the pins are then resampled from loop()
+std::atomic<bool> buttonOverflow(false);
+Debouncer buttons[BUTTON_COUNT] = {Debouncer(cfg::DEBOUNCE_MS),
+                                   Debouncer(cfg::DEBOUNCE_MS),
+                                   Debouncer(cfg::DEBOUNCE_MS)};
+
+/**
+ * Control changes collected since the last frame. Later inputs overwrite
+ * earlier ones field by field; negative or zero values mean unchanged.
+ */
+struct PendingControl {
+  int preset = -1;
+  int brightness = -1;
+  bool color = false;
+  int colorPreset = 0;  // preset targeted when the color was sent
+  CRGB colorValue;
+  uint32_t stepMs = 0;
+  uint32_t frameMs = 0;
+  int32_t fadeMs = -1;
+  bool publish = false;  // presets or live colors were changed in place
+  bool sequence = false;  // play the stored sequence from the start
+};
+PendingControl pending;
+uint32_t lastApply = 0;
+
+// Last state pushed to WebSocket clients; changes are sent at most once
+// per frame
+StateSnapshot broadcastState;
+bool broadcastValid = false;
+uint32_t lastBroadcast = 0;
 
-bool wifiConnecting = false;
-uint32_t wifiConnectStart = 0;
+/**
+ * WiFi connection states driven by handleWiFi(). Nothing in it waits, so
+ * animation and input keep running while the connection comes and goes.
+ *
+ * - `IDLE`        not started yet
+ * - `CONNECTING`  WiFi.begin() issued, waiting for an address
+ * - `CONNECTED`   station mode is up
+ * - `BACKOFF`     lost or failed connection, retrying after a delay
+ * - `AP`          never connected; serving the setup access point
+ */
+enum class WifiState { IDLE, CONNECTING, CONNECTED, BACKOFF, AP };
+WifiState wifiState = WifiState::IDLE;
+// Services brought up by handleStartup() after the first light, in order
+enum class Startup : uint8_t { NETWORK, SERVERS, BLUETOOTH, DONE };
+Startup startup = Startup::NETWORK;
+uint32_t wifiStateSince = 0;
 uint32_t wifiLastPrint = 0;
-bool wifiApActive = false;
+// Reconnect attempts since the connection was last up
+uint8_t wifiAttempts = 0;
+uint32_t wifiRetryDelay = 0;
+// Falls back to the access point only until a connection succeeded once
+bool wifiEverConnected = false;
+
+// Power manager state; lastActivity is the last applied control change
+bool powerIdle = false;
+uint32_t lastActivity = 0;
 
+// Restart requested by an HTTP handler, run once the response went out
+bool restartPending = false;
+uint32_t restartRequested = 0;
+
+/**
+ * Settings are cached in RAM: loadSettings() reads NVS once at boot and
+ * changes only mark their namespace dirty. handleSettings() writes the
+ * dirty namespaces back after a quiet period.
+ */
 Preferences prefs;
-String storedSSID;
+String storedSSID;       // "wifi"
 String storedPassword;
 String storedHostname;
+// holdPreset and syncRole live in "cfg"; the boot record with the last
+// preset, brightness and speed in "boot"
+enum SettingsGroup : uint8_t {
+  SETTINGS_WIFI = 1,
+  SETTINGS_CFG = 2,
+  SETTINGS_BOOT = 4
+};
+uint8_t settingsDirty = 0;
+WriteBehind settingsWrites(cfg::SETTINGS_QUIET_MS, cfg::SETTINGS_MAX_DELAY_MS);
+
+void markSettingsDirty(uint8_t groups) {
+  settingsDirty |= groups;
+  settingsWrites.mark(millis());
+}
 
 WebServer server(80);
 WebSocketsServer ws(81);
+#ifdef USE_BLE
+// GATT control service; the characteristics are described in the README
+const char BLE_SERVICE_UUID[] = "9b1d0001-6f3c-4c8e-a4f1-3d2b7a5e0c11";
+const char BLE_STATE_UUID[] = "9b1d0006-6f3c-4c8e-a4f1-3d2b7a5e0c11";
+enum BleField : uint8_t {
+  BLE_PRESET,
+  BLE_BRIGHTNESS,
+  BLE_COLOR,
+  BLE_FRAME,
+  BLE_COMMAND,
+  BLE_FIELD_COUNT
+};
+const char *const BLE_FIELD_UUIDS[BLE_FIELD_COUNT] = {
+    "9b1d0002-6f3c-4c8e-a4f1-3d2b7a5e0c11",
+    "9b1d0003-6f3c-4c8e-a4f1-3d2b7a5e0c11",
+    "9b1d0004-6f3c-4c8e-a4f1-3d2b7a5e0c11",
+    "9b1d0005-6f3c-4c8e-a4f1-3d2b7a5e0c11",
+    "9b1d0007-6f3c-4c8e-a4f1-3d2b7a5e0c11"};
+struct BleWrite {
+  BleField field;
+  uint16_t len;
+  uint8_t data[cfg::BLE_WRITE_MAX];
+};
+// Filled by the characteristic callbacks in the NimBLE host task
+SpscQueue<BleWrite, 8> bleWrites;
+// Writes lost because loop() fell behind
+std::atomic<uint32_t> bleDropped(0);
+
+/** Queues writes to one characteristic for loop() */
+class BleWriteCallbacks : public NimBLECharacteristicCallbacks {
+ public:
+  explicit BleWriteCallbacks(BleField field) : field_(field) {}
+
+  void onWrite(NimBLECharacteristic *c) override {
+    NimBLEAttValue value = c->getValue();
+    BleWrite w;
+    w.field = field_;
+    w.len = static_cast<uint16_t>(value.length());
+    if (w.len == 0 || w.len > sizeof(w.data))
+      return;
+    memcpy(w.data, value.data(), w.len);
+    if (!bleWrites.push(w))
+      bleDropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  BleField field_;
+};
+
+BleWriteCallbacks bleCallbacks[BLE_FIELD_COUNT] = {
+    BleWriteCallbacks(BLE_PRESET), BleWriteCallbacks(BLE_BRIGHTNESS),
+    BleWriteCallbacks(BLE_COLOR), BleWriteCallbacks(BLE_FRAME),
+    BleWriteCallbacks(BLE_COMMAND)};
+NimBLEServer *bleServer = nullptr;
+NimBLECharacteristic *bleState = nullptr;
+#else
 BluetoothSerial bt;
+LineAssembler btLine;
+#endif
 
-void loadCredentials() {
+/** Read the credentials and "cfg" settings; the boot record is separate */
+void loadSettings() {
   prefs.begin("wifi", true);
   storedSSID = prefs.getString("ssid", "");
   storedPassword = prefs.getString("pass", "");
   storedHostname = prefs.getString("host", DEFAULT_HOST);
   prefs.end();
+  prefs.begin("cfg", true);
+  holdPreset = prefs.getInt("hold", 0);
+  uint8_t role = prefs.getUChar("sync", 0);
+  prefs.end();
+  if (role <= static_cast<uint8_t>(SyncRole::FOLLOWER))
+    syncRole = static_cast<SyncRole>(role);
 }
 
-void saveCredentials(const String &ssid, const String &password,
-                     const String &host) {
-  prefs.begin("wifi", false);
-  prefs.putString("ssid", ssid);
-  prefs.putString("pass", password);
-  prefs.putString("host", host);
-  prefs.end();
+void setCredentials(const String &ssid, const String &password,
+                    const String &host) {
   storedSSID = ssid;
   storedPassword = password;
   storedHostname = host;
+  markSettingsDirty(SETTINGS_WIFI);
 }
 
-void loadHoldPreset() {
-  prefs.begin("cfg", true);
-  holdPreset = prefs.getInt("hold", 0);
-  prefs.end();
-}
-
-void saveHoldPreset() {
-  prefs.begin("cfg", false);
-  prefs.putInt("hold", holdPreset);
-  prefs.end();
+void setWifiState(WifiState state) {
+  wifiState = state;
+  wifiStateSince = millis();
 }
 
 /**
- * Connect to WiFi using stored credentials if available
+ * Start connecting to WiFi using stored credentials if available.
+ * Returns at once; handleWiFi() follows the attempt.
  */
-
 void connectWiFi() {
-  loadCredentials();
   const char *ssid =
       storedSSID.length() ? storedSSID.c_str() : cfg::SSID;
   const char *pass =
       storedPassword.length() ? storedPassword.c_str() : cfg::PASSWORD;
-  const char *host =
-      storedHostname.length() ? storedHostname.c_str() : DEFAULT_HOST;
-  WiFi.disconnect(true);
+  // Reconnects are driven by handleWiFi() with backoff instead
+  WiFi.setAutoReconnect(false);
   WiFi.mode(WIFI_STA);
-  wifiApActive = false;
   WiFi.begin(ssid, pass);
-  wifiConnectStart = millis();
-  wifiConnecting = true;
+  setWifiState(WifiState::CONNECTING);
   wifiLastPrint = 0;
   Serial.print("Connecting to WiFi");
 }
 
+/** Wait before the next attempt, longer after each failed one */
+void scheduleReconnect() {
+  wifiRetryDelay = backoffDelay(wifiAttempts, cfg::WIFI_RETRY_MIN_MS,
+                                cfg::WIFI_RETRY_MAX_MS);
+  if (wifiAttempts < UINT8_MAX)
+    ++wifiAttempts;
+  Serial.printf("WiFi retry in %lu ms\n",
+                static_cast<unsigned long>(wifiRetryDelay));  // NOLINT(runtime/int)
+  setWifiState(WifiState::BACKOFF);
+}
+
+void startAccessPoint(const char *host) {
+  WiFi.mode(WIFI_AP);
+  if (WiFi.softAP(host)) {
+    Serial.print("Started access point ");
+    Serial.print(host);
+    Serial.print(" at ");
+    Serial.println(WiFi.softAPIP());
+  }
+  setWifiState(WifiState::AP);
+}
+
+/** Advance the WiFi state machine; never blocks */
 void handleWiFi() {
-  if (!wifiConnecting)
-    return;
   const char *host =
       storedHostname.length() ? storedHostname.c_str() : DEFAULT_HOST;
-  if (WiFi.status() == WL_CONNECTED) {
-    wifiConnecting = false;
-    Serial.println(" connected!");
-    Serial.println(WiFi.localIP());
-    if (MDNS.begin(host)) {
-      Serial.print("mDNS active on ");
-      Serial.print(host);
-      Serial.println(".local");
+  uint32_t elapsed = millis() - wifiStateSince;
+  switch (wifiState) {
+  case WifiState::CONNECTING:
+    if (WiFi.status() == WL_CONNECTED) {
+      Serial.println(" connected!");
+      Serial.println(WiFi.localIP());
+      if (MDNS.begin(host)) {
+        Serial.print("mDNS active on ");
+        Serial.print(host);
+        Serial.println(".local");
+      }
+      ArduinoOTA.setHostname(host);
+      wifiAttempts = 0;
+      wifiEverConnected = true;
+      setWifiState(WifiState::CONNECTED);
+    } else if (elapsed > cfg::WIFI_CONNECT_TIMEOUT_MS) {
+      Serial.println(" failed to connect.");
+      if (wifiEverConnected)
+        scheduleReconnect();
+      else
+        startAccessPoint(host);
+    } else if (millis() - wifiLastPrint > 500) {
+      Serial.print('.');
+      wifiLastPrint = millis();
     }
-    ArduinoOTA.setHostname(host);
-    return;
-  }
-  if (millis() - wifiConnectStart > 15000) {
-    wifiConnecting = false;
-    Serial.println(" failed to connect.");
-    WiFi.mode(WIFI_AP);
-    if (WiFi.softAP(host)) {
-      Serial.print("Started access point ");
-      Serial.print(host);
-      Serial.print(" at ");
-      Serial.println(WiFi.softAPIP());
+    break;
+  case WifiState::CONNECTED:
+    if (WiFi.status() != WL_CONNECTED) {
+      Serial.println("\nWiFi disconnected, reconnecting...");
+      scheduleReconnect();
     }
-    wifiApActive = true;
-    return;
-  }
-  if (millis() - wifiLastPrint > 500) {
-    Serial.print('.');
-    wifiLastPrint = millis();
+    break;
+  case WifiState::BACKOFF:
+    if (elapsed >= wifiRetryDelay)
+      connectWiFi();
+    break;
+  case WifiState::IDLE:
+  case WifiState::AP:
+    break;
   }
 }
 
+/** Restart after cfg::RESTART_DELAY_MS without blocking the caller */
+void requestRestart() {
+  restartPending = true;
+  restartRequested = millis();
+}
+
+void handleDeferredRestart() {
+  if (restartPending && millis() - restartRequested >= cfg::RESTART_DELAY_MS)
+    ESP.restart();
+}
+
 void loadDefaultPresets() {
   presets.clear();
   for (size_t i = 0; i < DEFAULT_PRESET_COUNT; ++i) {
     PresetData data;
     memcpy_P(&data, &defaultPresets[i], sizeof(PresetData));
     Preset p;
-#if KEEP_NAMES_IN_FLASH
     p.flashName = reinterpret_cast<const __FlashStringHelper *>(
         pgm_read_ptr(&defaultPresetNames[data.nameIdx]));
-#else
-    char buf[32];
-    strcpy_P(buf,
-             reinterpret_cast<const char *>(
-                 pgm_read_ptr(&defaultPresetNames[data.nameIdx])));
-    p.name = String(buf);
-#endif
     p.type = data.type;
     p.color = data.color;
-    presets.push_back(p);
+    presets.push_back(std::move(p));
   }
 }
 
-void loadCustomPresets() {
-  File f = SPIFFS.open("/presets.txt", "r");
-  if (!f)
-    return;
-  while (f.available()) {
-    String line = f.readStringUntil('\n');
-    line.trim();
-    if (!line.length())
-      continue;
-    int first = line.indexOf(',');
-    int second = line.indexOf(',', first + 1);
-    if (first == -1 || second == -1)
-      continue;
-    String name = line.substring(0, first);
-    int type = line.substring(first + 1, second).toInt();
-    String colStr = line.substring(second + 1);
-    Preset p;
-#if KEEP_NAMES_IN_FLASH
-    p.flashName = nullptr;
-#endif
-    p.name = name;
-    p.type = static_cast<PresetType>(type);
-    p.color = CRGB::Black;
-    if (p.type == PresetType::CUSTOM) {
-      p.leds.assign(cfg::NUM_LEDS, CRGB::Black);
-      p.effects.assign(cfg::NUM_LEDS, 0);
-      int idx = 0;
-      while (idx < cfg::NUM_LEDS && colStr.length()) {
-        int sep = colStr.indexOf(';');
-        String tok = sep == -1 ? colStr : colStr.substring(0, sep);
-        if (tok.startsWith("#"))
-          tok.remove(0, 1);
-        uint32_t val;
-        if (parseHexColor(tok.c_str(), val)) {
-          p.leds[idx] = CRGB((val >> 16) & 0xFF, (val >> 8) & 0xFF,
-                             val & 0xFF);
-        }
-        if (sep == -1)
-          colStr = "";
-        else
-          colStr = colStr.substring(sep + 1);
-        ++idx;
+/**
+ * Parse one "name,type,color" line of the legacy text preset file. CUSTOM
+ * presets store one `;` separated color per LED instead of a single color.
+ */
+bool parsePresetLine(const String &line, Preset &p) {
+  int first = line.indexOf(',');
+  int second = line.indexOf(',', first + 1);
+  if (first == -1 || second == -1)
+    return false;
+  String name = line.substring(0, first);
+  int type = line.substring(first + 1, second).toInt();
+  String colStr = line.substring(second + 1);
+  p.setName(name.c_str(), name.length());
+  p.type = static_cast<PresetType>(type);
+  p.color = CRGB::Black;
+  if (p.type == PresetType::CUSTOM) {
+    p.leds.fill(CRGB::Black);
+    p.effects.fill(0);
+    int idx = 0;
+    while (idx < cfg::NUM_LEDS && colStr.length()) {
+      int sep = colStr.indexOf(';');
+      String tok = sep == -1 ? colStr : colStr.substring(0, sep);
+      if (tok.startsWith("#"))
+        tok.remove(0, 1);
+      uint32_t val;
+      if (parseHexColor(tok.c_str(), val)) {
+        p.leds[idx] = CRGB((val >> 16) & 0xFF, (val >> 8) & 0xFF,
+                           val & 0xFF);
       }
-    } else {
-      uint32_t val = strtoul(colStr.c_str(), nullptr, 16);
-      p.color = CRGB((val >> 16) & 0xFF, (val >> 8) & 0xFF, val & 0xFF);
+      if (sep == -1)
+        colStr = "";
+      else
+        colStr = colStr.substring(sep + 1);
+      ++idx;
     }
-    presets.push_back(p);
+  } else {
+    uint32_t val = strtoul(colStr.c_str(), nullptr, 16);
+    p.color = CRGB((val >> 16) & 0xFF, (val >> 8) & 0xFF, val & 0xFF);
   }
-  f.close();
+  return true;
 }
 
-void saveCustomPresets() {
-  File f = SPIFFS.open("/presets.txt", "w");
-  if (!f)
-    return;
-  for (size_t i = DEFAULT_PRESET_COUNT; i + 1 < presets.size(); ++i) {
-    if (presets[i].type == PresetType::CUSTOM) {
-      String line =
-#if KEEP_NAMES_IN_FLASH
-          (presets[i].flashName
-               ? String(FPSTR(presets[i].flashName))
-               : presets[i].name) +
-#else
-          presets[i].name +
-#endif
-          "," + String(static_cast<int>(presets[i].type)) + ",";
-      for (int j = 0; j < cfg::NUM_LEDS; ++j) {
-        char buf[8];
-        CRGB c = j < presets[i].leds.size() ? presets[i].leds[j] : CRGB::Black;
-        snprintf(buf, sizeof(buf), "%02x%02x%02x", c.r, c.g, c.b);
-        line += buf;
-        if (j + 1 < cfg::NUM_LEDS)
-          line += ';';
-      }
-      line += "\n";
-      f.print(line);
-    } else {
-      char buf[64];
-      String n =
-#if KEEP_NAMES_IN_FLASH
-          (presets[i].flashName
-               ? String(FPSTR(presets[i].flashName))
-               : presets[i].name);
-#else
-          presets[i].name;
-#endif
-      snprintf(buf, sizeof(buf), "%s,%d,%02x%02x%02x\n", n.c_str(),
-               static_cast<int>(presets[i].type), presets[i].color.r,
-               presets[i].color.g, presets[i].color.b);
-      f.print(buf);
+constexpr char PRESET_FILE[] = "/presets.bin";
+constexpr char PRESET_TMP_FILE[] = "/presets.tmp";
+// Append-only log of preset changes since the preset file was last
+// compacted: a store header, then [slot, 16 bit LE][record] entries.
+// Slot 0 is the first custom preset.
+constexpr char PRESET_JOURNAL[] = "/presets.jnl";
+// Text files used before the binary store; migrated once at boot
+constexpr char LEGACY_PRESET_FILE[] = "/presets.txt";
+constexpr char LEGACY_PRESET_JOURNAL[] = "/presets.log";
+
+constexpr size_t PRESET_RECORD_SIZE = presetRecordSize(cfg::NUM_LEDS);
+
+/** Serialize a preset into PRESET_RECORD_SIZE bytes */
+void encodePreset(const Preset &p, uint8_t *rec) {
+  memset(rec, 0, PRESET_RECORD_SIZE);
+  rec[PRESET_REC_TYPE] = static_cast<uint8_t>(p.type);
+  rec[PRESET_REC_COLOR] = p.color.r;
+  rec[PRESET_REC_COLOR + 1] = p.color.g;
+  rec[PRESET_REC_COLOR + 2] = p.color.b;
+  const char *name = p.displayName();
+  size_t n = strnlen(name, PRESET_NAME_MAX);
+  rec[PRESET_REC_NAME_LEN] = n;
+  memcpy(rec + PRESET_REC_NAME, name, n);
+  uint8_t *ledBytes = rec + PRESET_REC_LEDS;
+  uint8_t *effectBytes = rec + presetRecordEffects(cfg::NUM_LEDS);
+  for (size_t i = 0; i < cfg::NUM_LEDS; ++i) {
+    ledBytes[i * 3] = p.leds[i].r;
+    ledBytes[i * 3 + 1] = p.leds[i].g;
+    ledBytes[i * 3 + 2] = p.leds[i].b;
+    effectBytes[i] = p.effects[i];
+  }
+}
+
+/** Deserialize a record written for @p ledCount LEDs */
+void decodePreset(const uint8_t *rec, uint8_t ledCount, Preset &p) {
+  uint8_t type = rec[PRESET_REC_TYPE];
+  p.type = type < PRESET_TYPE_COUNT ? static_cast<PresetType>(type)
+                                    : PresetType::STATIC;
+  p.color = CRGB(rec[PRESET_REC_COLOR], rec[PRESET_REC_COLOR + 1],
+                 rec[PRESET_REC_COLOR + 2]);
+  p.setName(reinterpret_cast<const char *>(rec + PRESET_REC_NAME),
+            rec[PRESET_REC_NAME_LEN]);
+  p.leds.fill(CRGB::Black);
+  p.effects.fill(0);
+  if (p.type == PresetType::CUSTOM) {
+    const uint8_t *ledBytes = rec + PRESET_REC_LEDS;
+    const uint8_t *effectBytes = rec + presetRecordEffects(ledCount);
+    for (size_t i = 0; i < cfg::NUM_LEDS && i < ledCount; ++i) {
+      p.leds[i] = CRGB(ledBytes[i * 3], ledBytes[i * 3 + 1],
+                       ledBytes[i * 3 + 2]);
+      p.effects[i] = effectBytes[i];
     }
   }
-  f.close();
 }
 
-/**
- * Update LEDs based on active preset
- */
-void applyPreset() {
-  switch (presets[currentPreset].type) {
-  case PresetType::STATIC:
-    fill_solid(leds, cfg::NUM_LEDS, presets[currentPreset].color);
-    break;
+/** Put the preset at @p idx, appending it if it is the next new slot */
+void storeLoadedPreset(size_t idx, Preset &p) {
+  if (idx < presets.size())
+    presets[idx] = std::move(p);
+  else if (idx == presets.size())
+    presets.push_back(std::move(p));
+}
 
-  case PresetType::RAINBOW:
-    EVERY_N_MILLISECONDS(50) { ++rainbowHue; }
-    fill_rainbow(leds, cfg::NUM_LEDS, rainbowHue, 7);
-    break;
+/** Read a whole file with a single allocation and read call */
+bool readWholeFile(const char *path, std::vector<uint8_t> &buf) {
+  File f = SPIFFS.open(path, "r");
+  if (!f)
+    return false;
+  buf.resize(f.size());
+  size_t got = f.read(buf.data(), buf.size());
+  f.close();
+  buf.resize(got);
+  return true;
+}
 
-  case PresetType::POLICE_NL: {
-    static bool phase = false;        // false = groups 1&3, true = groups 2&4
-    static uint32_t lastToggle = 0;
-    static uint32_t flashCount = 0;
-    static bool strobe = false;
-    static uint8_t strobeGroup = 0;   // 1 or 2 when strobing
-    const uint16_t flashInterval = 250;  // ms
-    const uint16_t strobeInterval = 20;  // ms
-
-    if (millis() - lastToggle >= flashInterval) {
-      phase = !phase;
-      lastToggle = millis();
-      ++flashCount;
-      strobe = false;
-      strobeGroup = 0;
-      if (flashCount % 20 == 0) {
-        strobe = true;
-        strobeGroup = 1;  // groups 1 & 3
-      } else if (flashCount % 20 == 10) {
-        strobe = true;
-        strobeGroup = 2;  // groups 2 & 4
-      }
+/** Load presets from the text files used by older firmware */
+void loadLegacyPresets() {
+  File f = SPIFFS.open(LEGACY_PRESET_FILE, "r");
+  if (f) {
+    while (f.available()) {
+      String line = f.readStringUntil('\n');
+      line.trim();
+      Preset p;
+      if (line.length() && parsePresetLine(line, p))
+        presets.push_back(std::move(p));
     }
+    f.close();
+  }
 
-    auto setGroup = [&](int start, int count, CRGB color) {
-      for (int i = start; i < start + count; ++i) {
-        leds[i] = color;
-      }
-    };
+  File j = SPIFFS.open(LEGACY_PRESET_JOURNAL, "r");
+  if (!j)
+    return;
+  while (j.available()) {
+    String line = j.readStringUntil('\n');
+    line.trim();
+    int colon = line.indexOf(':');
+    Preset p;
+    if (colon <= 0 || !parsePresetLine(line.substring(colon + 1), p))
+      continue;
+    storeLoadedPreset(DEFAULT_PRESET_COUNT + line.substring(0, colon).toInt(),
+                      p);
+  }
+  j.close();
+}
 
-    bool strobeOn = strobe && ((millis() / strobeInterval) % 2 == 0);
+/**
+ * Append custom presets from flash to `presets`.
+ * @return true if they came from the legacy text files and the binary
+ *         store still has to be written with finishPresetMigration()
+ */
+bool loadCustomPresets() {
+  // compactPresets() only removes the store once the temporary file is
+  // complete, so a temporary file without a store finishes a compaction
+  // and one next to the store is an interrupted write.
+  if (SPIFFS.exists(PRESET_TMP_FILE)) {
+    if (SPIFFS.exists(PRESET_FILE))
+      SPIFFS.remove(PRESET_TMP_FILE);
+    else
+      SPIFFS.rename(PRESET_TMP_FILE, PRESET_FILE);
+  }
+  if (!SPIFFS.exists(PRESET_FILE) && SPIFFS.exists(LEGACY_PRESET_FILE)) {
+    loadLegacyPresets();
+    return true;
+  }
 
-    // Map groups: 0-2, 3-5, 6-8, 9-12
-    if (strobe) {
-      if (strobeGroup == 1) {
-        setGroup(0, 3, strobeOn ? CRGB::Blue : CRGB::Black);
-        setGroup(6, 3, strobeOn ? CRGB::Blue : CRGB::Black);
-        setGroup(3, 3, CRGB::Black);
-        setGroup(9, 4, CRGB::Black);
-      } else {
-        setGroup(3, 3, strobeOn ? CRGB::Blue : CRGB::Black);
-        setGroup(9, 4, strobeOn ? CRGB::Blue : CRGB::Black);
-        setGroup(0, 3, CRGB::Black);
-        setGroup(6, 3, CRGB::Black);
-      }
-    } else if (!phase) {
-      setGroup(0, 3, CRGB::Blue);
-      setGroup(6, 3, CRGB::Blue);
-      setGroup(3, 3, CRGB::Black);
-      setGroup(9, 4, CRGB::Black);
-    } else {
-      setGroup(3, 3, CRGB::Blue);
-      setGroup(9, 4, CRGB::Blue);
-      setGroup(0, 3, CRGB::Black);
-      setGroup(6, 3, CRGB::Black);
+  std::vector<uint8_t> buf;
+  uint16_t count;
+  uint8_t ledCount;
+  if (readWholeFile(PRESET_FILE, buf) &&
+      readPresetStoreHeader(buf.data(), buf.size(), count, ledCount)) {
+    size_t recSize = presetRecordSize(ledCount);
+    size_t stored = (buf.size() - PRESET_STORE_HEADER) / recSize;
+    if (count > stored)
+      count = stored;
+    presets.reserve(presets.size() + count + 1);
+    const uint8_t *rec = buf.data() + PRESET_STORE_HEADER;
+    for (size_t i = 0; i < count; ++i, rec += recSize) {
+      Preset p;
+      decodePreset(rec, ledCount, p);
+      presets.push_back(std::move(p));
     }
-    break;
   }
 
-  case PresetType::POLICE_USA: {
-    static uint8_t step = 0;
-    static uint32_t lastPulse = 0;
-    const uint8_t pulses = 3;
-    const uint16_t pulseInterval = 150;  // ms per on/off step
-
-    if (millis() - lastPulse >= pulseInterval) {
-      lastPulse = millis();
-      step = (step + 1) % (pulses * 4);
+  if (readWholeFile(PRESET_JOURNAL, buf) &&
+      readPresetStoreHeader(buf.data(), buf.size(), count, ledCount)) {
+    size_t entrySize = 2 + presetRecordSize(ledCount);
+    for (size_t off = PRESET_STORE_HEADER; off + entrySize <= buf.size();
+         off += entrySize) {
+      size_t slot = buf[off] | (buf[off + 1] << 8);
+      Preset p;
+      decodePreset(&buf[off + 2], ledCount, p);
+      storeLoadedPreset(DEFAULT_PRESET_COUNT + slot, p);
+      ++journalEntries;
     }
+  }
+  return false;
+}
 
-    bool on = (step % 2 == 0);
-    bool left = (step / (pulses * 2)) % 2 == 0;
+/**
+ * Rewrite the preset file with all custom presets and drop the journal.
+ * The file is written under a temporary name first so a power cut can't
+ * leave a truncated store behind; loadCustomPresets() finishes a rename
+ * that was cut short.
+ */
+bool compactPresets() {
+  File f = SPIFFS.open(PRESET_TMP_FILE, "w");
+  if (!f)
+    return false;
+  size_t first = DEFAULT_PRESET_COUNT;
+  size_t last = presets.size() - 1;  // "Off" is not stored
+  uint8_t header[PRESET_STORE_HEADER];
+  writePresetStoreHeader(header, last > first ? last - first : 0,
+                         cfg::NUM_LEDS);
+  bool ok = f.write(header, sizeof(header)) == sizeof(header);
+  static uint8_t rec[PRESET_RECORD_SIZE];
+  for (size_t i = first; ok && i < last; ++i) {
+    encodePreset(presets[i], rec);
+    ok = f.write(rec, sizeof(rec)) == sizeof(rec);
+  }
+  f.close();
+  if (!ok) {
+    SPIFFS.remove(PRESET_TMP_FILE);
+    return false;
+  }
+  SPIFFS.remove(PRESET_FILE);
+  // Until the rename succeeds the journal is still needed; the next boot
+  // moves the temporary file into place
+  if (!SPIFFS.rename(PRESET_TMP_FILE, PRESET_FILE))
+    return false;
+  SPIFFS.remove(PRESET_JOURNAL);
+  journalEntries = 0;
+  return true;
+}
 
-    auto setRange = [&](int start, int count, CRGB color) {
-      for (int i = start; i < start + count; ++i) {
-        leds[i] = color;
-      }
-    };
+/** Write the binary store after loadCustomPresets() read legacy files */
+void finishPresetMigration() {
+  if (!compactPresets())
+    return;
+  SPIFFS.remove(LEGACY_PRESET_FILE);
+  SPIFFS.remove(LEGACY_PRESET_JOURNAL);
+}
 
-    if (on) {
-      setRange(0, 6, left ? CRGB::Red : CRGB::Black);
-      setRange(6, 1, CRGB::White);
-      setRange(7, 6, left ? CRGB::Black : CRGB::Blue);
-    } else {
-      fill_solid(leds, cfg::NUM_LEDS, CRGB::Black);
-    }
-    break;
+/**
+ * Write pending preset changes. Changes are appended to the journal; the
+ * preset file is only rewritten when @p compact is set or the journal grew
+ * past cfg::JOURNAL_MAX_ENTRIES.
+ */
+void flushPresets(bool compact) {
+  if (dirtyPresets.empty() && !compact)
+    return;
+  if (compact ||
+      journalEntries + dirtyPresets.size() > cfg::JOURNAL_MAX_ENTRIES) {
+    if (compactPresets())
+      dirtyPresets.clear();
+    return;
+  }
+  File j = SPIFFS.open(PRESET_JOURNAL, "a");
+  if (!j) {
+    if (compactPresets())
+      dirtyPresets.clear();
+    return;
   }
+  bool ok = true;
+  if (j.size() == 0) {
+    uint8_t header[PRESET_STORE_HEADER];
+    writePresetStoreHeader(header, 0, cfg::NUM_LEDS);
+    ok = j.write(header, sizeof(header)) == sizeof(header);
+  }
+  // New slots must be replayed in order, so write them sorted
+  std::sort(dirtyPresets.begin(), dirtyPresets.end());
+  static uint8_t entry[2 + PRESET_RECORD_SIZE];
+  for (size_t i = 0; ok && i < dirtyPresets.size(); ++i) {
+    size_t idx = dirtyPresets[i];
+    if (idx + 1 >= presets.size())
+      continue;
+    size_t slot = idx - DEFAULT_PRESET_COUNT;
+    entry[0] = slot & 0xFF;
+    entry[1] = slot >> 8;
+    encodePreset(presets[idx], entry + 2);
+    ok = j.write(entry, sizeof(entry)) == sizeof(entry);
+    if (ok)
+      ++journalEntries;
+  }
+  j.close();
+  if (!ok) {
+    // Entries appended after a torn one would be replayed misaligned, so
+    // rewrite the store instead, and keep doing so until that works
+    journalEntries = cfg::JOURNAL_MAX_ENTRIES;
+    if (compactPresets())
+      dirtyPresets.clear();
+    return;
+  }
+  dirtyPresets.clear();
+}
 
-  case PresetType::STROBE: {
-    static bool on = false;
-    EVERY_N_MILLISECONDS(50) { on = !on; }
-    fill_solid(leds, cfg::NUM_LEDS, on ? CRGB::White : CRGB::Black);
-  } break;
+/**
+ * Queue the preset at @p idx for saving. Only custom presets are stored;
+ * the write happens once changes have been quiet for cfg::PRESET_SAVE_DELAY_MS.
+ */
+void markPresetDirty(size_t idx) {
+  if (idx < DEFAULT_PRESET_COUNT || idx + 1 >= presets.size())
+    return;
+  if (std::find(dirtyPresets.begin(), dirtyPresets.end(), idx) ==
+      dirtyPresets.end())
+    dirtyPresets.push_back(idx);
+  lastPresetChange = millis();
+}
 
-  case PresetType::LAVALAMP: {
-    static uint8_t lavaPos = 0;
-    EVERY_N_MILLISECONDS(50) { ++lavaPos; }
-    for (int i = 0; i < cfg::NUM_LEDS; ++i) {
-      leds[i] = CHSV((lavaPos + i * 10) % 255, 200, 255);
-    }
-  } break;
-  case PresetType::FIRE: {
-    for (int i = 0; i < cfg::NUM_LEDS; ++i) {
-      leds[i] = CHSV(random8(0, 40), 255, random8(120, 255));
-    }
-  } break;
-  case PresetType::CANDLE: {
-    uint8_t bri = random8(150, 255);
-    CRGB color = CHSV(random8(25, 45), 200, bri);
-    fill_solid(leds, cfg::NUM_LEDS, color);
-  } break;
-  case PresetType::PARTY: {
-    for (int i = 0; i < cfg::NUM_LEDS; ++i) {
-      leds[i] = CHSV(random8(), 255, 255);
-    }
-  } break;
+// Boot record as last read or written, so unchanged state isn't rewritten
+uint8_t bootRecord[BOOT_RECORD_HEADER + PRESET_RECORD_SIZE];
+
+/** Cache the active preset, brightness and speed for the next boot */
+void writeBootRecord() {
+  // While BTN_HOLD is held, the preset it replaced is the one to restore
+  int idx = savedPreset >= 0 ? savedPreset : currentPreset;
+  static uint8_t rec[sizeof(bootRecord)];
+  BootState st;
+  st.preset = idx;
+  st.brightness = brightness;
+  st.stepMs = animInterval;
+  writeBootRecordHeader(rec, st, cfg::NUM_LEDS);
+  encodePreset(presets[idx], rec + BOOT_RECORD_HEADER);
+  if (memcmp(rec, bootRecord, sizeof(rec)) == 0)
+    return;
+  prefs.begin("boot", false);
+  prefs.putBytes("last", rec, sizeof(rec));
+  prefs.end();
+  memcpy(bootRecord, rec, sizeof(rec));
+}
 
-  case PresetType::CUSTOM: {
-    if (!presets[currentPreset].leds.empty()) {
-      for (int i = 0; i < cfg::NUM_LEDS; ++i) {
-        leds[i] = presets[currentPreset].leds[i];
-      }
-    } else {
-      fill_solid(leds, cfg::NUM_LEDS, CRGB::Black);
-    }
-  } break;
+/**
+ * Read the boot record into @p p and @p st. Only NVS is touched, so this
+ * works before SPIFFS is mounted.
+ * @return false if there is no valid record
+ */
+bool loadBootRecord(Preset &p, BootState &st) {
+  prefs.begin("boot", true);
+  size_t len = prefs.getBytes("last", bootRecord, sizeof(bootRecord));
+  prefs.end();
+  if (!readBootRecordHeader(bootRecord, len, cfg::NUM_LEDS, st)) {
+    memset(bootRecord, 0, sizeof(bootRecord));
+    return false;
   }
+  decodePreset(bootRecord + BOOT_RECORD_HEADER, cfg::NUM_LEDS, p);
+  return true;
+}
 
-  FastLED.show();
+/** Write all dirty settings to NVS now */
+void flushSettings() {
+  if (settingsDirty & SETTINGS_WIFI) {
+    prefs.begin("wifi", false);
+    prefs.putString("ssid", storedSSID);
+    prefs.putString("pass", storedPassword);
+    prefs.putString("host", storedHostname);
+    prefs.end();
+  }
+  if (settingsDirty & SETTINGS_CFG) {
+    prefs.begin("cfg", false);
+    prefs.putInt("hold", holdPreset);
+    prefs.putUChar("sync", static_cast<uint8_t>(syncRole));
+    prefs.end();
+  }
+  if (settingsDirty & SETTINGS_BOOT)
+    writeBootRecord();
+  settingsDirty = 0;
+  settingsWrites.clear();
 }
 
 /**
- * Cycle to the next preset
+ * Flush queued preset changes and settings after a quiet period.
+ * Called from loop().
  */
-void nextPreset() {
-  currentPreset = (currentPreset + 1) % presets.size();
-  applyPreset();
+void handlePresetPersistence() {
+  uint32_t now = millis();
+  if (!dirtyPresets.empty() &&
+      now - lastPresetChange > cfg::PRESET_SAVE_DELAY_MS)
+    flushPresets(false);
+  if (settingsWrites.due(now))
+    flushSettings();
 }
 
 /**
- * Cycle to the previous preset
+ * Record the time since @p start (a cycle count) for @p stage.
+ * @return the current cycle count, to start the next stage from
  */
-void previousPreset() {
-  currentPreset = (currentPreset - 1 + presets.size()) % presets.size();
-  applyPreset();
+uint32_t endStage(Stage stage, uint32_t start) {
+  uint32_t now = ESP.getCycleCount();
+  stageStats[stage].record((now - start) / cpuMhz);
+  return now;
 }
 
 /**
- * Serve the main HTML interface listing presets
- * The page template is stored entirely in PROGMEM with a %PRESETS% placeholder
- * that gets replaced with the generated preset list.
+ * Send `leds` to the strip unless it matches the last frame shown.
+ * WS2812 output blocks interrupts on the RMT path, so skipping it matters.
  */
-const char HTML_PAGE[] PROGMEM = R"html(
-<!DOCTYPE html>
-<html>
-<head>
-  <title>Solder Goggles</title>
-  <meta name="viewport" content="width=device-width, initial-scale=1">
-  <link rel="stylesheet" href="https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/css/bootstrap.min.css">
-  <link rel="preconnect" href="https://fonts.googleapis.com">
-  <link rel="preconnect" href="https://fonts.gstatic.com" crossorigin>
-  <link href="https://fonts.googleapis.com/css2?family=Orbitron:wght@400;700&display=swap" rel="stylesheet">
-  <style>
-    body {
-      font-family: 'Orbitron', sans-serif;
-      background: radial-gradient(circle at top, #0d1b2a, #000);
-      color: #d8e3ff;
-    }
-    h1 {
-      letter-spacing: 2px;
-    }
-    .btn-primary,
-    .btn-secondary {
-      background-color: #1282a2;
-      border-color: #1282a2;
+void showFrame(uint8_t bright) {
+  if (frameShown && bright == shownBrightness &&
+      memcmp(leds, shownLeds, sizeof(leds)) == 0)
+    return;
+  if (FastLED.getBrightness() != bright)
+    FastLED.setBrightness(bright);
+  uint32_t start = ESP.getCycleCount();
+  FastLED.show();
+  endStage(STAGE_SHOW, start);
+  framesShown.fetch_add(1, std::memory_order_relaxed);
+  memcpy(shownLeds, leds, sizeof(leds));
+  shownBrightness = bright;
+  frameShown = true;
+}
+
+/**
+ * Render loop pinned to cfg::RENDER_CORE. Frames are paced with
+ * vTaskDelayUntil so network load on the other core doesn't shift them.
+ */
+void renderTask(void *) {
+  RenderState state;
+  uint32_t lastGeneration = 0;
+  bool first = true;
+  TickType_t lastWake = xTaskGetTickCount();
+  bool fading = false;
+  bool fadeFrozen = false;  // Fading from a still snapshot of the screen
+  uint32_t fadeStart = 0;
+  SyncTarget sync;
+  PhaseSample sample;
+  SequencePlayer player;
+  uint32_t sequenceRun = 0;
+  for (;;) {
+    uint32_t generation = renderState.generation();
+    uint32_t now = millis();
+    if (first || generation != lastGeneration) {
+      int previous = state.preset;
+      renderState.read(state);
+      EffectParams params;
+      params.color = state.color;
+      params.leds = state.leds;
+      params.ledCount = cfg::NUM_LEDS;
+      params.segments = topology::SEGMENTS;
+      params.segmentCount = topology::SEGMENT_COUNT;
+      params.stepMs = state.stepMs;
+      if (state.preset == SEQUENCE_PRESET &&
+          (previous != SEQUENCE_PRESET || state.sequenceRun != sequenceRun)) {
+        player.start(state.sequence, now);
+        sequenceRun = state.sequenceRun;
+      }
+      // Only a preset switch restarts the effect; brightness, speed and
+      // color changes keep its phase.
+      if (first || state.preset != previous || state.type != engine.type()) {
+        // Streamed frames and sequences cut in and out without a fade
+        if (!first && state.fadeMs && state.preset >= 0 && previous >= 0) {
+          // Start from what is on screen. Normally the outgoing effect
+          // keeps animating; a blend left by an interrupted fade has no
+          // engine behind it, so that one fades out as a still frame.
+          fadeFrozen = fading;
+          if (!fadeFrozen)
+            fadeEngine = engine;
+          memcpy(fadeFrom, leds, sizeof(leds));
+          fadeStart = now;
+          fading = true;
+        } else {
+          fading = false;
+        }
+        engine.activate(state.type, params);
+      } else {
+        engine.setParams(params);
+      }
+      lastGeneration = generation;
+      first = false;
     }
-    .btn-secondary {
-      background-color: #1e2d45;
+    syncTarget.read(sync);
+    if (sync.active && sync.preset == state.preset) {
+      int32_t since = static_cast<int32_t>(now - sync.time);
+      engine.syncPhase(extrapolatePhase(sync.phase, since, sync.stepMs), now);
     }
-    .list-group-item {
-      background-color: rgba(255,255,255,0.03);
-      border-color: #1282a2;
+    uint32_t start = ESP.getCycleCount();
+    bool changed;
+    if (fading) {
+      // Both engines only redraw their buffer when their frame changed
+      if (!fadeFrozen)
+        fadeEngine.render(fadeFrom, cfg::NUM_LEDS, now);
+      engine.render(fadeTo, cfg::NUM_LEDS, now);
+      uint8_t amount = crossfadeAmount(now - fadeStart, state.fadeMs);
+      crossfade(fadeFrom, fadeTo, amount, leds, cfg::NUM_LEDS);
+      fading = amount < 255;
+      changed = true;
+    } else if (state.preset == SEQUENCE_PRESET) {
+      changed = player.render(leds, cfg::NUM_LEDS, now);
+    } else {
+      changed = engine.render(leds, cfg::NUM_LEDS, now);
     }
-    a.btn-link {
-      color: #5bc0eb;
+    endStage(STAGE_RENDER, start);
+    sample.preset = state.preset;
+    sample.phase = engine.phase();
+    sample.time = now;
+    renderPhase.write(sample);
+    framesRendered.fetch_add(1, std::memory_order_relaxed);
+    if (changed)
+      showFrame(state.brightness);
+    bool animated = state.preset == SEQUENCE_PRESET ? player.playing()
+                                                    : engine.animated();
+    if (!fading && !animated && renderState.generation() == lastGeneration) {
+      // Nothing changes until applyPreset() publishes a new state
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      lastWake = xTaskGetTickCount();
+      continue;
     }
-  </style>
-</head>
-<body class="container py-4">
-  <h1 class="mb-4 text-center">Solder Goggles</h1>
-  <div class='mb-3 text-center'>
-    <a class='btn btn-secondary me-2' href='/prev'>Prev</a>
-    <a class='btn btn-secondary' href='/next'>Next</a>
-  </div>
-  <div class='mb-4'>
-    <label for='bright' class='form-label'>Brightness</label>
-    <input type='range' class='form-range' id='bright' min='0' max='255'
-           value='%BRIGHT%'
-           onchange="location.href='/bright?b=' + this.value">
-  </div>
-  <ul class="list-group">
-  %PRESETS%
-  </ul>
-  <form method='POST' action='/add' class='row row-cols-lg-auto g-3 align-items-center mt-4'>
-    <div class='col-12'>
-      <input class='form-control' id='name' name='name' placeholder='Name'>
-    </div>
-    <div class='col-12'>
-      <input class='form-control' id='color' name='color' type='color'>
-    </div>
-    <div class='col-12'>
-      <button class='btn btn-primary'>Add</button>
-    </div>
-  </form>
-  <form method='GET' action='/hold' class='row row-cols-lg-auto g-3 align-items-center mt-3'>
-    <div class='col-12'>
-      <select class='form-select' id='hold' name='i'>
-        %HOLD_OPTIONS%
-      </select>
-    </div>
-    <div class='col-12'>
-      <button class='btn btn-secondary'>Set Hold Preset</button>
-    </div>
-  </form>
-  <a class='btn btn-link mt-3' href='/wifi'>WiFi setup</a>
-  <a class='btn btn-link mt-3' href='/update'>OTA update</a>
-</body>
-</html>
-)html";
+    TickType_t period = pdMS_TO_TICKS(state.frameMs);
+    if (period == 0)
+      period = 1;
+    if (xTaskGetTickCount() - lastWake >= period)
+      framesLate.fetch_add(1, std::memory_order_relaxed);
+    vTaskDelayUntil(&lastWake, period);
+  }
+}
 
-void handleRoot() {
-  String presetList;
-  // Reserve some space to avoid repeated reallocations while building the
-  // preset list. Each list element is roughly 80 characters long.
-  presetList.reserve(presets.size() * 80);
-  for (size_t i = 0; i < presets.size(); ++i) {
-    presetList += "<li class='list-group-item position-relative'>";
-      presetList += "<a href='/set?i=" + String(i) +
-                     "' class='d-flex justify-content-between align-items-center text-reset text-decoration-none stretched-link'>";  // NOLINT
-#if KEEP_NAMES_IN_FLASH
-    if (presets[i].flashName)
-      presetList += FPSTR(presets[i].flashName);
-    else
-      presetList += presets[i].name;
-#else
-    presetList += presets[i].name;
-#endif
-      if (i == currentPreset)
-        presetList += " <span class='badge bg-success position-relative z-3'>active</span>";  // NOLINT
-    presetList += "</a></li>";
-  }
-
-  String holdOpts;
-  holdOpts.reserve(presets.size() * 40);
-  for (size_t i = 0; i < presets.size(); ++i) {
-    holdOpts += "<option value='" + String(i) + "'";
-    if (i == holdPreset)
-      holdOpts += " selected";
-    holdOpts += ">";
-#if KEEP_NAMES_IN_FLASH
-    if (presets[i].flashName)
-      holdOpts += String(FPSTR(presets[i].flashName));
-    else
-      holdOpts += presets[i].name;
-#else
-    holdOpts += presets[i].name;
-#endif
-    holdOpts += "</option>";
+/**
+ * Publish preset @p p with index @p idx, or the streamed colors while live,
+ * together with brightness and speed to the render task
+ */
+void publishState(const Preset &p, int idx) {
+  static RenderState next;
+  if (liveActive) {
+    next.preset = LIVE_PRESET;
+    next.type = PresetType::CUSTOM;
+    memcpy(next.leds, liveLeds, sizeof(liveLeds));
+  } else if (sequenceActive) {
+    next.preset = SEQUENCE_PRESET;
+    next.sequence = storedSequence;
+    next.sequenceRun = sequenceRuns;
+  } else {
+    next.preset = idx;
+    next.type = p.type;
+    next.color = p.color;
+    std::copy(p.leds.begin(), p.leds.end(), next.leds);
   }
+  next.brightness = brightness;
+  next.stepMs = animInterval;
+  next.frameMs = frameInterval;
+  next.fadeMs = fadeInterval;
+  renderState.write(next);
+  if (renderTaskHandle)
+    xTaskNotifyGive(renderTaskHandle);
+}
 
-  String html = FPSTR(HTML_PAGE);
-  html.replace("%PRESETS%", presetList);
-  html.replace("%BRIGHT%", String(brightness));
-  html.replace("%HOLD_OPTIONS%", holdOpts);
-  server.send(200, "text/html", html);
+/** Publish the active preset, brightness and speed to the render task */
+void applyPreset() {
+  publishState(presets[currentPreset], currentPreset);
+}
+
+/** Preset the pending changes will leave active */
+int targetPreset() {
+  return pending.preset >= 0 ? pending.preset : currentPreset;
+}
+
+/** Queue a preset switch for the next frame */
+void requestPreset(int idx) {
+  pending.preset = idx;
+}
+
+/** Queue a re-publish for changes made to presets or live colors in place */
+void requestApply() {
+  pending.publish = true;
 }
 
 /**
- * Add a new static preset from form input
+ * Apply the queued control changes at most once per frame, or once per
+ * cfg::CONTROL_MAX_MS with a slow frame period, so input never waits on
+ * the render rate. However fast commands arrive, they are coalesced into
+ * one new state per interval.
  */
-void handleAdd() {
-#if USE_AUTH
-  if (!server.hasArg("token") || server.arg("token") != cfg::TOKEN) {
-    server.send(403, "text/html",
-                "<html><body><p>Invalid token.</p><a href='/' >Back</a></body></html>");  // NOLINT
+void applyPendingControl() {
+  uint32_t now = millis();
+  if (now - lastApply < controlInterval())
+    return;
+  if (pending.preset < 0 && pending.brightness < 0 && !pending.color &&
+      pending.stepMs == 0 && pending.frameMs == 0 && pending.fadeMs < 0 &&
+      !pending.publish && !pending.sequence)
     return;
+  if (pending.preset >= 0 &&
+      static_cast<size_t>(pending.preset) < presets.size()) {
+    currentPreset = pending.preset;
+    sequenceActive = false;
   }
-#endif
-  if (!server.hasArg("name") || !server.hasArg("color")) {
+  if (pending.sequence && storedSequence.frames) {
+    sequenceActive = true;
+    ++sequenceRuns;
+  }
+  if (pending.brightness >= 0)
+    brightness = pending.brightness;
+  if (pending.color && pending.colorPreset >= 0 &&
+      static_cast<size_t>(pending.colorPreset) < presets.size())
+    presets[pending.colorPreset].color = pending.colorValue;
+  if (pending.stepMs)
+    animInterval = pending.stepMs;
+  if (pending.frameMs)
+    frameInterval = pending.frameMs;
+  if (pending.fadeMs >= 0)
+    fadeInterval = pending.fadeMs;
+  pending = PendingControl();
+  lastApply = now;
+  lastActivity = now;
+  applyPreset();
+  markSettingsDirty(SETTINGS_BOOT);
+}
+
+/**
+ * Cycle to the next preset
+ */
+void nextPreset() {
+  requestPreset((targetPreset() + 1) % presets.size());
+}
+
+/**
+ * Cycle to the previous preset
+ */
+void previousPreset() {
+  requestPreset((targetPreset() - 1 + presets.size()) % presets.size());
+}
+
+/**
+ * Work an HTTP handler hands to the control path. Handlers run in the
+ * HTTP task and never touch presets or settings themselves: they parse
+ * the request, queue a call whose `run` executes in loop() and send the
+ * reply once it returns. The call lives on the handler's stack, which is
+ * safe because the handler waits for it.
+ */
+struct HttpCall {
+  void (*run)(HttpCall &call);
+  int value = 0;
+  const String *args[3] = {nullptr, nullptr, nullptr};
+  bool ok = true;    // false if the control path rejected the request
+  String reply;
+  TaskHandle_t waiter = nullptr;
+};
+SpscQueue<HttpCall *, 4> httpCalls;
+TaskHandle_t httpTaskHandle = nullptr;
+
+/** Run @p call on the control path and wait for it; HTTP task only */
+void callControl(HttpCall &call) {
+  call.waiter = xTaskGetCurrentTaskHandle();
+  while (!httpCalls.push(&call))
+    vTaskDelay(1);
+  xTaskNotifyGive(loopTaskHandle);
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+/** Execute queued HTTP calls in loop() and release their handlers */
+void handleHttpCalls() {
+  HttpCall *call;
+  while (httpCalls.pop(call)) {
+    call->run(*call);
+    xTaskNotifyGive(call->waiter);
+  }
+}
+
+/** Answer a form submission by going back to the UI */
+void redirectHome() {
+  server.sendHeader("Location", "/");
+  server.send(303);
+}
+
+/**
+ * Buffers the pieces of a chunked response so each sendContent() call
+ * carries a full chunk instead of a few bytes.
+ */
+class ChunkWriter {
+ public:
+  ChunkWriter() : len_(0) {}
+
+  void write(const char *s, size_t n) {
+    if (n > sizeof(buf_) - len_) {
+      flush();
+      if (n >= sizeof(buf_)) {
+        server.sendContent(s, n);
+        return;
+      }
+    }
+    memcpy(buf_ + len_, s, n);
+    len_ += n;
+  }
+
+  void print(const char *s) { write(s, strlen(s)); }
+
+  void print(const String &s) { write(s.c_str(), s.length()); }
+
+  /** Send the remaining bytes and terminate the chunked response. */
+  void end() {
+    flush();
+    server.sendContent("");
+  }
+
+ private:
+  void flush() {
+    if (len_ > 0) {
+      server.sendContent(buf_, len_);
+      len_ = 0;
+    }
+  }
+
+  char buf_[cfg::HTTP_CHUNK_SIZE];
+  size_t len_;
+};
+
+/** Start a 200 response whose body follows through a ChunkWriter */
+void beginChunked(const char *type) {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, type, "");
+}
+
+/**
+ * Stream a template split by splitTemplate(), calling @p fill for each
+ * placeholder. The response size is unknown up front, so it is sent
+ * chunked and never held in RAM as a whole.
+ */
+void streamTemplate(const TemplateSegment *segs, size_t count,
+                    void (*fill)(ChunkWriter &out, int marker)) {
+  beginChunked("text/html");
+  ChunkWriter out;
+  for (size_t i = 0; i < count; ++i) {
+    out.write(segs[i].text, segs[i].len);
+    if (segs[i].marker >= 0)
+      fill(out, segs[i].marker);
+  }
+  out.end();
+}
+
+/**
+ * Serve one of the pre-gzipped UI files. The browser revalidates with the
+ * ETag on each visit and usually gets an empty 304 back.
+ */
+void serveAsset(const WebAsset &asset) {
+  server.sendHeader("ETag", asset.etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == asset.etag) {
+    server.send(304);
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, asset.type, reinterpret_cast<PGM_P>(asset.data),
+                asset.len);
+}
+
+/**
+ * Report the dynamic state the web UI renders, e.g.
+ * `{"preset":0,"hold":0,"bright":255,"speed":50,"live":false,
+ * "presets":[{"name":"Static","type":0}]}`.
+ */
+void handleApiState() {
+  HttpCall call;
+  // Formatted on the control path so the preset list can't change midway
+  call.run = [](HttpCall &c) {
+    String &out = c.reply;
+    out.reserve(80 + presets.size() * 48);
+    out += "{\"preset\":";
+    out += currentPreset;
+    out += ",\"hold\":";
+    out += holdPreset;
+    out += ",\"bright\":";
+    out += brightness;
+    out += ",\"speed\":";
+    out += animInterval;
+    out += liveActive ? ",\"live\":true" : ",\"live\":false";
+    out += ",\"presets\":[";
+    char name[PRESET_NAME_MAX * 6 + 1];
+    for (size_t i = 0; i < presets.size(); ++i) {
+      out += i == 0 ? "{\"name\":\"" : ",{\"name\":\"";
+      jsonEscape(presets[i].displayName(), name, sizeof(name));
+      out += name;
+      out += "\",\"type\":";
+      out += static_cast<int>(presets[i].type);
+      out += "}";
+    }
+    out += "]}";
+  };
+  callControl(call);
+  server.send(200, "application/json", call.reply);
+}
+
+void printMetric(ChunkWriter &out, const char *name, const char *stage,
+                 const char *quantile, unsigned long value) {  // NOLINT(runtime/int)
+  char line[112];
+  int n;
+  if (stage && quantile)
+    n = snprintf(line, sizeof(line), "%s{stage=\"%s\",quantile=\"%s\"} %lu\n",
+                 name, stage, quantile, value);
+  else if (stage)
+    n = snprintf(line, sizeof(line), "%s{stage=\"%s\"} %lu\n", name, stage,
+                 value);
+  else
+    n = snprintf(line, sizeof(line), "%s %lu\n", name, value);
+  if (n > 0 && static_cast<size_t>(n) < sizeof(line))
+    out.write(line, n);
+}
+
+/** Stage timings, counters and heap usage in Prometheus text format */
+void handleMetrics() {
+  beginChunked("text/plain; version=0.0.4");
+  ChunkWriter out;
+  out.print("# TYPE goggles_stage_microseconds summary\n");
+  for (uint8_t i = 0; i < STAGE_COUNT; ++i) {
+    const StageStats &st = stageStats[i];
+    const char *name = STAGE_NAMES[i];
+    printMetric(out, "goggles_stage_microseconds", name, "0.5",
+                st.percentile(500));
+    printMetric(out, "goggles_stage_microseconds", name, "0.99",
+                st.percentile(990));
+    printMetric(out, "goggles_stage_microseconds_sum", name, nullptr,
+                static_cast<unsigned long>(st.sum()));  // NOLINT(runtime/int)
+    printMetric(out, "goggles_stage_microseconds_count", name, nullptr,
+                st.count());
+  }
+  out.print("# TYPE goggles_stage_min_microseconds gauge\n");
+  for (uint8_t i = 0; i < STAGE_COUNT; ++i)
+    printMetric(out, "goggles_stage_min_microseconds", STAGE_NAMES[i],
+                nullptr, stageStats[i].min());
+  out.print("# TYPE goggles_stage_max_microseconds gauge\n");
+  for (uint8_t i = 0; i < STAGE_COUNT; ++i)
+    printMetric(out, "goggles_stage_max_microseconds", STAGE_NAMES[i],
+                nullptr, stageStats[i].max());
+  out.print("# TYPE goggles_frames_rendered_total counter\n");
+  printMetric(out, "goggles_frames_rendered_total", nullptr, nullptr,
+              framesRendered.load(std::memory_order_relaxed));
+  out.print("# TYPE goggles_frames_shown_total counter\n");
+  printMetric(out, "goggles_frames_shown_total", nullptr, nullptr,
+              framesShown.load(std::memory_order_relaxed));
+  out.print("# TYPE goggles_frames_late_total counter\n");
+  printMetric(out, "goggles_frames_late_total", nullptr, nullptr,
+              framesLate.load(std::memory_order_relaxed));
+  out.print("# TYPE goggles_udp_packets_total counter\n");
+  printMetric(out, "goggles_udp_packets_total", nullptr, nullptr, udpPackets);
+  out.print("# TYPE goggles_udp_dropped_total counter\n");
+  printMetric(out, "goggles_udp_dropped_total", nullptr, nullptr, udpDropped);
+  out.print("# TYPE goggles_udp_lost_total counter\n");
+  printMetric(out, "goggles_udp_lost_total", nullptr, nullptr,
+              ddpSequence.lost() + e131Sequence.lost());
+  out.print("# TYPE goggles_udp_late_total counter\n");
+  printMetric(out, "goggles_udp_late_total", nullptr, nullptr,
+              ddpSequence.late() + e131Sequence.late());
+#ifdef USE_BLE
+  out.print("# TYPE goggles_ble_dropped_total counter\n");
+  printMetric(out, "goggles_ble_dropped_total", nullptr, nullptr,
+              bleDropped.load(std::memory_order_relaxed));
+#endif
+  out.print("# TYPE goggles_heap_free_bytes gauge\n");
+  printMetric(out, "goggles_heap_free_bytes", nullptr, nullptr,
+              ESP.getFreeHeap());
+  out.print("# TYPE goggles_heap_min_free_bytes gauge\n");
+  printMetric(out, "goggles_heap_min_free_bytes", nullptr, nullptr,
+              ESP.getMinFreeHeap());
+  out.print("# TYPE goggles_heap_max_block_bytes gauge\n");
+  printMetric(out, "goggles_heap_max_block_bytes", nullptr, nullptr,
+              ESP.getMaxAllocHeap());
+  out.end();
+}
+
+/**
+ * Format the `stats` reply: [min, avg, max, p99] in microseconds per stage,
+ * frame counters, UDP pixel input and heap, e.g.
+ * `{"stages":{"loop":[3,40,900,120],...},
+ * "frames":{"rendered":100,"shown":12,"late":0},"udp":{...},"heap":{...}}`.
+ * @return length of the message in @p out, 0 if it did not fit
+ */
+size_t formatStats(char *out, size_t size) {
+  size_t len = 0;
+  auto append = [&](int n) {
+    len = (n < 0 || len + n >= size) ? size : len + n;
+  };
+  append(snprintf(out, size, "{\"stages\":{"));
+  for (uint8_t i = 0; i < STAGE_COUNT && len < size; ++i) {
+    const StageStats &st = stageStats[i];
+    append(snprintf(out + len, size - len, "%s\"%s\":[%lu,%lu,%lu,%lu]",
+                    i ? "," : "", STAGE_NAMES[i],
+                    static_cast<unsigned long>(st.min()),  // NOLINT(runtime/int)
+                    static_cast<unsigned long>(st.avg()),  // NOLINT(runtime/int)
+                    static_cast<unsigned long>(st.max()),  // NOLINT(runtime/int)
+                    static_cast<unsigned long>(st.percentile(990))));  // NOLINT(runtime/int)
+  }
+  if (len < size)
+    append(snprintf(
+        out + len, size - len,
+        "},\"frames\":{\"rendered\":%lu,\"shown\":%lu,\"late\":%lu},"
+        "\"udp\":{\"packets\":%lu,\"dropped\":%lu,\"lost\":%lu,"
+        "\"late\":%lu},"
+        "\"heap\":{\"free\":%lu,\"min\":%lu,\"maxBlock\":%lu}}",
+        static_cast<unsigned long>(framesRendered.load()),  // NOLINT(runtime/int)
+        static_cast<unsigned long>(framesShown.load()),  // NOLINT(runtime/int)
+        static_cast<unsigned long>(framesLate.load()),  // NOLINT(runtime/int)
+        static_cast<unsigned long>(udpPackets),  // NOLINT(runtime/int)
+        static_cast<unsigned long>(udpDropped),  // NOLINT(runtime/int)
+        static_cast<unsigned long>(  // NOLINT(runtime/int)
+            ddpSequence.lost() + e131Sequence.lost()),
+        static_cast<unsigned long>(  // NOLINT(runtime/int)
+            ddpSequence.late() + e131Sequence.late()),
+        static_cast<unsigned long>(ESP.getFreeHeap()),  // NOLINT(runtime/int)
+        static_cast<unsigned long>(ESP.getMinFreeHeap()),  // NOLINT(runtime/int)
+        static_cast<unsigned long>(ESP.getMaxAllocHeap())));  // NOLINT(runtime/int)
+  return len < size ? len : 0;
+}
+
+/** Send the `stats` reply to the WebSocket client or Bluetooth peer */
+void sendStats(int replyTo) {
+  static char msg[1024];
+  size_t len = formatStats(msg, sizeof(msg));
+  if (len == 0)
+    return;
+  if (replyTo == REPLY_BLUETOOTH) {
+#ifndef USE_BLE
+    // Too long for a notification, so BLE centrals don't get it
+    bt.write(reinterpret_cast<const uint8_t *>(msg), len);
+    bt.write('\n');
+#endif
+  } else {
+    ws.sendTXT(static_cast<uint8_t>(replyTo), msg, len);
+  }
+}
+
+/**
+ * Add a new static preset from form input
+ */
+void handleAdd() {
+#if USE_AUTH
+  if (!server.hasArg("token") || server.arg("token") != cfg::TOKEN) {
+    server.send(403, "text/html",
+                "<html><body><p>Invalid token.</p><a href='/' >Back</a></body></html>");  // NOLINT
+    return;
+  }
+#endif
+  if (!server.hasArg("name") || !server.hasArg("color")) {
     server.send(400, "text/html",
                 "<html><body><p>Missing name or color.</p><a href='/' >Back</a></body></html>");  // NOLINT
     return;
@@ -698,110 +1607,261 @@ void handleAdd() {
     return;
   }
 
-  {
+  HttpCall call;
+  call.value = colorVal;
+  call.args[0] = &name;
+  call.run = [](HttpCall &c) {
     Preset p;
-#if KEEP_NAMES_IN_FLASH
-    p.flashName = nullptr;
-#endif
-    p.name = name;
+    p.setName(c.args[0]->c_str(), c.args[0]->length());
     p.type = PresetType::STATIC;
-    p.color = CRGB((colorVal >> 16) & 0xFF, (colorVal >> 8) & 0xFF,
-                   colorVal & 0xFF);
-    presets.insert(presets.end() - 1, p);
+    p.color = CRGB((c.value >> 16) & 0xFF, (c.value >> 8) & 0xFF,
+                   c.value & 0xFF);
+    presets.insert(presets.end() - 1, std::move(p));
+    markPresetDirty(presets.size() - 2);
+    requestPreset(presets.size() - 2);
+  };
+  callControl(call);
+  redirectHome();
+}
+
+/** ESP-NOW receive callback; runs in the WiFi task */
+void onSyncReceive(const uint8_t *mac, const uint8_t *data, int len) {
+  if (syncRole != SyncRole::FOLLOWER || len != SYNC_MESSAGE_SIZE)
+    return;
+  SyncPacket pkt;
+  memcpy(pkt.data, data, SYNC_MESSAGE_SIZE);
+  pkt.len = len;
+  pkt.received = millis();
+  syncPackets.push(pkt);
+}
+
+/** The interface ESP-NOW can send on in the current WiFi mode */
+wifi_interface_t syncInterface() {
+  return WiFi.getMode() == WIFI_AP ? WIFI_IF_AP : WIFI_IF_STA;
+}
+
+/**
+ * Register the broadcast peer on the interface WiFi is running, moving
+ * it over when the access point fallback replaced the station.
+ */
+void addSyncPeer() {
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, SYNC_BROADCAST, sizeof(SYNC_BROADCAST));
+  peer.channel = 0;  // Whatever channel the interface is on
+  peer.ifidx = syncInterface();
+  peer.encrypt = false;
+  esp_err_t err = esp_now_is_peer_exist(SYNC_BROADCAST)
+                      ? esp_now_mod_peer(&peer)
+                      : esp_now_add_peer(&peer);
+  if (err != ESP_OK)
+    Serial.println("ESP-NOW peer setup failed");
+  syncPeerIf = peer.ifidx;
+}
+
+/**
+ * Bring up ESP-NOW for the sync role. Messages go to the broadcast
+ * address on the channel of the station, or of the access point in the
+ * fallback mode, so all units must join the same network (or none).
+ */
+void startSync() {
+  if (syncStarted || syncRole == SyncRole::OFF)
+    return;
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("ESP-NOW init failed");
+    return;
   }
-  currentPreset = presets.size() - 2;
-  saveCustomPresets();
-  applyPreset();
+  esp_now_register_recv_cb(onSyncReceive);
+  addSyncPeer();
+  syncStarted = true;
+}
 
-  server.sendHeader("Location", "/");
-  server.send(303);
+/** Stop following the leader; the effect keeps its current phase */
+void releaseSync() {
+  syncClock.reset();
+  syncReceivedValid = false;
+  syncTarget.write(SyncTarget());
+}
+
+void setSyncRole(SyncRole role) {
+  if (role == syncRole)
+    return;
+  syncRole = role;
+  markSettingsDirty(SETTINGS_CFG);
+  syncSentValid = false;
+  releaseSync();
+  startSync();
+}
+
+/**
+ * Adopt a leader message received at local time @p received. Only fields
+ * the leader changed are applied, so local changes stand until then; the
+ * phase is handed to the render task on every message.
+ */
+void followSync(const SyncMessage &msg, uint32_t received) {
+  syncClock.sample(msg.time, received);
+  if (!syncReceivedValid || msg.preset != syncReceived.preset) {
+    if (msg.preset < presets.size())
+      requestPreset(msg.preset);
+  }
+  if (!syncReceivedValid || msg.brightness != syncReceived.brightness)
+    pending.brightness = msg.brightness;
+  if (msg.stepMs && (!syncReceivedValid ||
+                     msg.stepMs != syncReceived.stepMs))
+    pending.stepMs = msg.stepMs;
+  syncReceived = msg;
+  syncReceivedValid = true;
+  syncLastReceive = received;
+  SyncTarget target;
+  target.active = true;
+  target.preset = msg.preset;
+  target.phase = msg.phase;
+  target.time = syncClock.toLocal(msg.time);
+  target.stepMs = msg.stepMs ? msg.stepMs : 1;
+  syncTarget.write(target);
 }
 
-void handleCommand(String msg) {
-  if (msg == "next") {
+/**
+ * Broadcast the leader state: at once (at most once per frame) when the
+ * preset, brightness or speed changed, otherwise every cfg::SYNC_BEACON_MS.
+ */
+void leadSync(uint32_t now) {
+  SyncMessage msg;
+  msg.group = cfg::SYNC_GROUP;
+  msg.brightness = brightness;
+  msg.preset = currentPreset;
+  msg.stepMs = animInterval;
+  bool changed = !syncSentValid || msg.preset != syncSent.preset ||
+                 msg.brightness != syncSent.brightness ||
+                 msg.stepMs != syncSent.stepMs;
+  uint32_t interval = changed ? frameInterval : cfg::SYNC_BEACON_MS;
+  if (syncSentValid && now - syncLastSend < interval)
+    return;
+  PhaseSample sample;
+  renderPhase.read(sample);
+  msg.time = now;
+  // Until the render task picked up a new preset its phase is still 0
+  msg.phase = sample.preset == currentPreset
+                  ? extrapolatePhase(sample.phase,
+                                     static_cast<int32_t>(now - sample.time),
+                                     animInterval)
+                  : 0;
+  uint8_t buf[SYNC_MESSAGE_SIZE];
+  encodeSyncMessage(msg, buf);
+  esp_now_send(SYNC_BROADCAST, buf, sizeof(buf));
+  syncSent = msg;
+  syncSentValid = true;
+  syncLastSend = now;
+}
+
+/** Lead or follow; a follower that lost its leader runs freely again */
+void handleSync() {
+  uint32_t now = millis();
+  SyncPacket pkt;
+  while (syncPackets.pop(pkt)) {
+    SyncMessage msg;
+    if (syncRole == SyncRole::FOLLOWER &&
+        decodeSyncMessage(pkt.data, pkt.len, cfg::SYNC_GROUP, msg))
+      followSync(msg, pkt.received);
+  }
+  if (!syncStarted)
+    return;
+  if (syncInterface() != syncPeerIf)
+    addSyncPeer();
+  if (syncRole == SyncRole::LEADER)
+    leadSync(now);
+  else if (syncReceivedValid && now - syncLastReceive > cfg::SYNC_TIMEOUT_MS)
+    releaseSync();
+}
+
+/**
+ * Queue the effect of one parsed command. Replies such as `stats` go to
+ * WebSocket client @p replyTo, or over Bluetooth for REPLY_BLUETOOTH.
+ */
+void runCommand(const Command &cmd, int replyTo) {
+  switch (cmd.type) {
+  case CommandType::NEXT:
     nextPreset();
-  } else if (msg == "prev") {
+    break;
+  case CommandType::PREV:
     previousPreset();
-  } else if (msg.startsWith("set:")) {
-    String idxStr = msg.substring(4);
-    bool digitsOnly = idxStr.length() > 0;
-    for (size_t i = 0; i < idxStr.length() && digitsOnly; ++i) {
-      digitsOnly = isDigit(idxStr[i]);
-    }
-    if (digitsOnly) {
-      int idx = idxStr.toInt();
-      if (idx >= 0 && idx < presets.size()) {
-        currentPreset = idx;
-        applyPreset();
-      }
-    }
-  } else if (msg.startsWith("bright:")) {
-    String valStr = msg.substring(7);
-    bool digitsOnly = valStr.length() > 0;
-    for (size_t i = 0; i < valStr.length() && digitsOnly; ++i) {
-      digitsOnly = isDigit(valStr[i]);
-    }
-    if (digitsOnly) {
-      int val = valStr.toInt();
-      if (val >= 0 && val <= 255) {
-        brightness = val;
-        FastLED.setBrightness(brightness);
-        applyPreset();
-      }
-    }
-  } else if (msg.startsWith("color:")) {
-    String colorStr = msg.substring(6);
-    if (colorStr.length() == 7 && colorStr[0] == '#') {
-      uint32_t val;
-      if (parseHexColor(colorStr.c_str() + 1, val)) {
-        presets[currentPreset].color =
-            CRGB((val >> 16) & 0xFF, (val >> 8) & 0xFF, val & 0xFF);
-        applyPreset();
-      }
-    }
-  } else if (msg.startsWith("speed:")) {
-    String valStr = msg.substring(6);
-    bool digitsOnly = valStr.length() > 0;
-    for (size_t i = 0; i < valStr.length() && digitsOnly; ++i) {
-      digitsOnly = isDigit(valStr[i]);
-    }
-    if (digitsOnly) {
-      int val = valStr.toInt();
-      if (val > 0)
-        animInterval = val;
-    }
-  } else if (msg.startsWith("leds:")) {
-    String data = msg.substring(5);
-    presets[currentPreset].type = PresetType::CUSTOM;
-    if (presets[currentPreset].leds.size() != cfg::NUM_LEDS)
-      presets[currentPreset].leds.assign(cfg::NUM_LEDS, CRGB::Black);
-    else
-      fill_solid(presets[currentPreset].leds.data(), cfg::NUM_LEDS,
-                 CRGB::Black);
-    if (presets[currentPreset].effects.size() != cfg::NUM_LEDS)
-      presets[currentPreset].effects.assign(cfg::NUM_LEDS, 0);
-    else
-      std::fill(presets[currentPreset].effects.begin(),
-                presets[currentPreset].effects.end(), 0);
-    int idx = 0;
-    while (idx < cfg::NUM_LEDS && data.length()) {
-      int sep = data.indexOf(',');
-      String tok = sep == -1 ? data : data.substring(0, sep);
-      if (tok.startsWith("#"))
-        tok.remove(0, 1);
-      uint32_t val;
-      if (parseHexColor(tok.c_str(), val)) {
-        presets[currentPreset].leds[idx] =
-            CRGB((val >> 16) & 0xFF, (val >> 8) & 0xFF, val & 0xFF);
-      }
-      if (sep == -1)
-        data = "";
-      else
-        data = data.substring(sep + 1);
-      ++idx;
+    break;
+  case CommandType::SET:
+    if (cmd.value < presets.size())
+      requestPreset(cmd.value);
+    break;
+  case CommandType::BRIGHT:
+    pending.brightness = cmd.value;
+    break;
+  case CommandType::COLOR:
+    pending.color = true;
+    pending.colorPreset = targetPreset();
+    pending.colorValue = CRGB(cmd.value);
+    break;
+  case CommandType::SPEED:
+    pending.stepMs = cmd.value;
+    break;
+  case CommandType::PLAY:
+    pending.sequence = true;
+    break;
+  case CommandType::FRAME:
+    pending.frameMs = cmd.value;
+    break;
+  case CommandType::FADE:
+    pending.fadeMs = cmd.value;
+    break;
+  case CommandType::LEDS: {
+    int idx = targetPreset();
+    Preset &p = presets[idx];
+    p.type = PresetType::CUSTOM;
+    p.leds.fill(CRGB::Black);
+    p.effects.fill(0);
+    for (size_t i = 0; i < cmd.ledCount && i < cfg::NUM_LEDS; ++i) {
+      p.leds[i] = CRGB(cmd.leds[i]);
     }
-    saveCustomPresets();
-    applyPreset();
+    markPresetDirty(idx);
+    requestApply();
+  } break;
+  case CommandType::SAVE:
+    flushPresets(true);
+    flushSettings();
+    break;
+  case CommandType::STATS:
+    sendStats(replyTo);
+    break;
+  case CommandType::SYNC:
+    setSyncRole(static_cast<SyncRole>(cmd.value));
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * Run a batch of commands from WebSocket, Bluetooth or HTTP, separated by
+ * ';' or newlines. The batch is all or nothing: if any command fails to
+ * parse none are run. Since control changes are applied once per frame,
+ * a valid batch shows up as a single new state.
+ * @p msg need not be NUL-terminated; nothing is allocated while parsing.
+ */
+void handleCommand(const char *msg, size_t len, int replyTo) {
+  Command cmd;
+  const char *rest = msg;
+  size_t restLen = len;
+  const char *one;
+  size_t oneLen;
+  bool any = false;
+  while (nextBatchCommand(rest, restLen, one, oneLen)) {
+    if (!parseCommand(one, oneLen, cmd))
+      return;
+    any = true;
+  }
+  if (!any)
+    return;
+  rest = msg;
+  restLen = len;
+  while (nextBatchCommand(rest, restLen, one, oneLen)) {
+    parseCommand(one, oneLen, cmd);
+    runCommand(cmd, replyTo);
   }
 }
 
@@ -813,15 +1873,19 @@ void handleSet() {
     server.send(400, "text/plain", "Missing index");
     return;
   }
-  int idx = server.arg("i").toInt();
-  if (idx < 0 || idx >= presets.size()) {
+  HttpCall call;
+  call.value = server.arg("i").toInt();
+  call.run = [](HttpCall &c) {
+    c.ok = c.value >= 0 && static_cast<size_t>(c.value) < presets.size();
+    if (c.ok)
+      requestPreset(c.value);
+  };
+  callControl(call);
+  if (!call.ok) {
     server.send(400, "text/plain", "Invalid index");
     return;
   }
-  currentPreset = idx;
-  applyPreset();
-  server.sendHeader("Location", "/");
-  server.send(303);
+  redirectHome();
 }
 
 /** Set the preset used when BTN_HOLD is pressed */
@@ -830,29 +1894,37 @@ void handleHold() {
     server.send(400, "text/plain", "Missing index");
     return;
   }
-  int idx = server.arg("i").toInt();
-  if (idx < 0 || idx >= presets.size()) {
+  HttpCall call;
+  call.value = server.arg("i").toInt();
+  call.run = [](HttpCall &c) {
+    c.ok = c.value >= 0 && static_cast<size_t>(c.value) < presets.size();
+    if (c.ok) {
+      holdPreset = c.value;
+      markSettingsDirty(SETTINGS_CFG);
+    }
+  };
+  callControl(call);
+  if (!call.ok) {
     server.send(400, "text/plain", "Invalid index");
     return;
   }
-  holdPreset = idx;
-  saveHoldPreset();
-  server.sendHeader("Location", "/");
-  server.send(303);
+  redirectHome();
 }
 
 /** Navigate to next preset */
 void handleNext() {
-  nextPreset();
-  server.sendHeader("Location", "/");
-  server.send(303);
+  HttpCall call;
+  call.run = [](HttpCall &) { nextPreset(); };
+  callControl(call);
+  redirectHome();
 }
 
 /** Navigate to previous preset */
 void handlePrev() {
-  previousPreset();
-  server.sendHeader("Location", "/");
-  server.send(303);
+  HttpCall call;
+  call.run = [](HttpCall &) { previousPreset(); };
+  callControl(call);
+  redirectHome();
 }
 
 /** Adjust brightness via query parameter 'b' (0-255) */
@@ -866,11 +1938,11 @@ void handleBright() {
     server.send(400, "text/plain", "Invalid value");
     return;
   }
-  brightness = val;
-  FastLED.setBrightness(brightness);
-  applyPreset();
-  server.sendHeader("Location", "/");
-  server.send(303);
+  HttpCall call;
+  call.value = val;
+  call.run = [](HttpCall &c) { pending.brightness = c.value; };
+  callControl(call);
+  redirectHome();
 }
 
 /**
@@ -879,8 +1951,8 @@ void handleBright() {
 const char WIFI_FORM_HTML[] PROGMEM = R"html(
 <!DOCTYPE html><html><head><title>WiFi Setup</title>
 <meta name='viewport' content='width=device-width, initial-scale=1'>
-<link rel='stylesheet' href='https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/css/bootstrap.min.css'></head>
-<body class='container py-4'>
+<link rel='stylesheet' href='/app.css'></head>
+<body class='container'>
 <h1 class='mb-3'>WiFi Credentials</h1>
 <form method='POST' action='/wifi' class='row g-3'>
 <div class='col-12'><label class='form-label' for='ssid'>SSID</label>
@@ -899,22 +1971,51 @@ const char WIFI_FORM_HTML[] PROGMEM = R"html(
 const char UPDATE_FORM_HTML[] PROGMEM = R"html(
 <!DOCTYPE html><html><head><title>OTA Update</title>
 <meta name='viewport' content='width=device-width, initial-scale=1'>
-<link rel='stylesheet' href='https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/css/bootstrap.min.css'></head>
-<body class='container py-4'>
+<link rel='stylesheet' href='/app.css'></head>
+<body class='container'>
 <h1 class='mb-3'>OTA Update</h1>
 <form method='POST' action='/update' enctype='multipart/form-data' class='row g-3'>
-<div class='col-12'><input class='form-control' type='file' name='firmware'></div>
+<div class='col-12'><input class='form-control' type='file' name='firmware' accept='.bin,.gz'></div>
 <div class='col-12'><button class='btn btn-primary'>Upload</button></div>
 </form>
+<p id='progress' class='mt-3'></p>
+<script>
+var ws = new WebSocket('ws://' + location.hostname + ':81/');
+ws.onmessage = function (ev) {
+  var msg = JSON.parse(ev.data);
+  if ('update' in msg)
+    document.getElementById('progress').textContent =
+        msg.update < 0 ? 'Update failed' : 'Uploaded ' + msg.update + '%';
+};
+</script>
 </body></html>
 )html";
 
+enum WifiMarker { WIFI_SSID_MARKER, WIFI_HOST_MARKER };
+const char *const WIFI_MARKERS[] = {"SSID", "HOST"};
+TemplateSegment wifiSegments[4];
+size_t wifiSegmentCount = 0;
+
+// Copies of the stored credentials taken for the form being streamed
+String wifiFormSSID;
+String wifiFormHost;
+
+void fillWifiForm(ChunkWriter &out, int marker) {
+  out.print(marker == WIFI_SSID_MARKER ? wifiFormSSID : wifiFormHost);
+}
+
 void handleWifiForm() {
-  loadCredentials();
-  String html = FPSTR(WIFI_FORM_HTML);
-  html.replace("%SSID%", storedSSID);
-  html.replace("%HOST%", storedHostname);
-  server.send(200, "text/html", html);
+  HttpCall call;
+  call.run = [](HttpCall &) {
+    wifiFormSSID = storedSSID;
+    wifiFormHost = storedHostname;
+  };
+  callControl(call);
+  if (wifiSegmentCount == 0)
+    wifiSegmentCount = splitTemplate(
+        WIFI_FORM_HTML, WIFI_MARKERS, 2, wifiSegments,
+        sizeof(wifiSegments) / sizeof(wifiSegments[0]));
+  streamTemplate(wifiSegments, wifiSegmentCount, fillWifiForm);
 }
 
 /**
@@ -927,11 +2028,24 @@ void handleWifiSave() {
                 "<html><body><p>Missing SSID, password, or device name.</p><a href='/wifi'>Back</a></body></html>");  // NOLINT
     return;
   }
-  saveCredentials(server.arg("ssid"), server.arg("password"),
-                  server.arg("host"));
-  connectWiFi();
-  server.sendHeader("Location", "/");
-  server.send(303);
+  String ssid = server.arg("ssid");
+  String password = server.arg("password");
+  String host = server.arg("host");
+  HttpCall call;
+  call.args[0] = &ssid;
+  call.args[1] = &password;
+  call.args[2] = &host;
+  call.run = [](HttpCall &c) {
+    setCredentials(*c.args[0], *c.args[1], *c.args[2]);
+    // An explicit save; don't wait for the quiet period
+    flushSettings();
+    // Fall back to the access point again if the new network is unreachable
+    wifiEverConnected = false;
+    wifiAttempts = 0;
+    connectWiFi();
+  };
+  callControl(call);
+  redirectHome();
 }
 
 /** Display OTA upload form */
@@ -939,91 +2053,689 @@ void handleUpdateForm() {
   server.send_P(200, "text/html", UPDATE_FORM_HTML);
 }
 
-/** Process uploaded firmware */
+// Firmware upload state; only touched by the HTTP task. Gzip images are
+// inflated as they arrive with the inflater in ROM, which needs its
+// decompressor state and a 32 KB window while an upload runs.
+struct OtaInflate {
+  tinfl_decompressor inflater;
+  uint8_t window[TINFL_LZ_DICT_SIZE];
+};
+OtaInflate *otaInflate = nullptr;
+bool otaFailed = false;
+bool otaFirstChunk = false;
+bool otaGzip = false;
+GzipHeader otaHeader;
+bool otaHeaderDone = false;
+bool otaInflated = false;  // End of the deflate stream reached
+size_t otaWindowPos = 0;
+uint8_t otaTrailer[GZIP_TRAILER];
+size_t otaTrailerLen = 0;
+uint32_t otaCrc = 0;
+uint32_t otaSize = 0;
+// Percent of the upload received, -1 after a failure; read by loop()
+std::atomic<int> updateProgress(-1);
+
+/** Write inflated firmware and fold it into the gzip checksum */
+bool writeFirmware(uint8_t *data, size_t len) {
+  otaCrc = crc32Update(otaCrc, data, len);
+  otaSize += len;
+  return Update.write(data, len) == len;
+}
+
+/**
+ * Inflate @p len bytes of the deflate stream into the OTA partition.
+ * Whatever follows the end of the stream is the trailer.
+ */
+bool inflateFirmware(const uint8_t *in, size_t len) {
+  tinfl_status st = TINFL_STATUS_NEEDS_MORE_INPUT;
+  while (!otaInflated && (len > 0 || st == TINFL_STATUS_HAS_MORE_OUTPUT)) {
+    size_t inBytes = len;
+    size_t outBytes = sizeof(otaInflate->window) - otaWindowPos;
+    st = tinfl_decompress(&otaInflate->inflater, in, &inBytes,
+                          otaInflate->window,
+                          otaInflate->window + otaWindowPos, &outBytes,
+                          TINFL_FLAG_HAS_MORE_INPUT);
+    in += inBytes;
+    len -= inBytes;
+    if (outBytes > 0 &&
+        !writeFirmware(otaInflate->window + otaWindowPos, outBytes))
+      return false;
+    otaWindowPos = (otaWindowPos + outBytes) % sizeof(otaInflate->window);
+    if (st < TINFL_STATUS_DONE)
+      return false;
+    otaInflated = st == TINFL_STATUS_DONE;
+  }
+  return true;
+}
+
+/**
+ * Keep the last GZIP_TRAILER bytes received. The inflater may read ahead
+ * into the trailer, so it is taken from the end of the upload instead.
+ */
+void keepTrailer(const uint8_t *buf, size_t len) {
+  if (len >= GZIP_TRAILER) {
+    memcpy(otaTrailer, buf + len - GZIP_TRAILER, GZIP_TRAILER);
+  } else {
+    memmove(otaTrailer, otaTrailer + len, GZIP_TRAILER - len);
+    memcpy(otaTrailer + GZIP_TRAILER - len, buf, len);
+  }
+  otaTrailerLen = std::min(otaTrailerLen + len, GZIP_TRAILER);
+}
+
+/** Pass one upload chunk on, raw or through the inflater */
+bool receiveFirmware(const uint8_t *buf, size_t len) {
+  if (otaFirstChunk) {
+    otaFirstChunk = false;
+    otaGzip = len >= 2 && buf[0] == 0x1F && buf[1] == 0x8B;
+    if (otaGzip) {
+      otaInflate = static_cast<OtaInflate *>(malloc(sizeof(OtaInflate)));
+      if (otaInflate == nullptr)
+        return false;
+      tinfl_init(&otaInflate->inflater);
+    }
+  }
+  if (!otaGzip) {
+    otaSize += len;
+    return Update.write(const_cast<uint8_t *>(buf), len) == len;
+  }
+  size_t used = 0;
+  if (!otaHeaderDone) {
+    GzipHeader::Status st = otaHeader.feed(buf, len, used);
+    if (st != GzipHeader::DONE)
+      return st == GzipHeader::MORE;
+    otaHeaderDone = true;
+  }
+  keepTrailer(buf + used, len - used);
+  return inflateFirmware(buf + used, len - used);
+}
+
+/** Finish the upload; false if the image is incomplete or corrupt */
+bool finishFirmware() {
+  if (otaGzip && (!otaInflated || otaTrailerLen != GZIP_TRAILER ||
+                  !checkGzipTrailer(otaTrailer, otaCrc, otaSize))) {
+    Serial.println("Update: corrupt gzip image");
+    return false;
+  }
+  if (!Update.end(true)) {
+    Update.printError(Serial);
+    return false;
+  }
+  Serial.printf("Update Success: %lu bytes\n",
+                static_cast<unsigned long>(otaSize));  // NOLINT(runtime/int)
+  return true;
+}
+
+void releaseInflater() {
+  free(otaInflate);
+  otaInflate = nullptr;
+}
+
+/**
+ * Process uploaded firmware, plain or gzip compressed; runs in the HTTP
+ * task alongside loop(), so animations keep running during the upload.
+ */
 void handleUpdateUpload() {
   HTTPUpload &up = server.upload();
   if (up.status == UPLOAD_FILE_START) {
     Serial.printf("Update: %s\n", up.filename.c_str());
-    if (!Update.begin(UPDATE_SIZE_UNKNOWN))
+    otaFailed = !Update.begin(UPDATE_SIZE_UNKNOWN);
+    if (otaFailed)
       Update.printError(Serial);
+    otaFirstChunk = true;
+    otaGzip = false;
+    otaHeader = GzipHeader();
+    otaHeaderDone = false;
+    otaInflated = false;
+    otaWindowPos = 0;
+    otaTrailerLen = 0;
+    otaCrc = 0;
+    otaSize = 0;
+    updateProgress.store(0, std::memory_order_relaxed);
   } else if (up.status == UPLOAD_FILE_WRITE) {
-    if (Update.write(up.buf, up.currentSize) != up.currentSize)
-      Update.printError(Serial);
+    if (!otaFailed && !receiveFirmware(up.buf, up.currentSize)) {
+      Serial.println("Update: write failed");
+      otaFailed = true;
+    }
+    size_t total = server.clientContentLength();
+    if (!otaFailed && total > 0 && up.totalSize < total)
+      updateProgress.store(static_cast<int>(up.totalSize * 100ULL / total),
+                           std::memory_order_relaxed);
   } else if (up.status == UPLOAD_FILE_END) {
-    if (Update.end(true))
-      Serial.printf("Update Success: %u bytes\n", up.totalSize);
-    else
-      Update.printError(Serial);
+    otaFailed = otaFailed || !finishFirmware();
+    if (otaFailed)
+      Update.abort();
+    releaseInflater();
+    updateProgress.store(otaFailed ? -1 : 100, std::memory_order_relaxed);
+  } else if (up.status == UPLOAD_FILE_ABORTED) {
+    otaFailed = true;
+    Update.abort();
+    releaseInflater();
+    updateProgress.store(-1, std::memory_order_relaxed);
   }
 }
 
-/** Return update status and reboot */
 void handleUpdateResult() {
-  server.send(200, "text/plain", Update.hasError() ? "FAIL" : "OK");
-  delay(1000);
-  if (!Update.hasError())
-    ESP.restart();
+  bool ok = !otaFailed && !Update.hasError();
+  server.send(200, "text/plain", ok ? "OK" : "FAIL");
+  if (ok) {
+    HttpCall call;
+    call.run = [](HttpCall &) {
+      flushPresets(false);
+      flushSettings();
+      requestRestart();
+    };
+    callControl(call);
+  }
+}
+
+/** Tell WebSocket clients how far a firmware upload got */
+void handleUpdateProgress() {
+  static int sent = -1;
+  int progress = updateProgress.load(std::memory_order_relaxed);
+  if (progress == sent)
+    return;
+  sent = progress;
+  char msg[24];
+  int len = snprintf(msg, sizeof(msg), "{\"update\":%d}", progress);
+  ws.broadcastTXT(msg, len);
+}
+
+/** Validate the mapped partition and make its sequence the stored one */
+bool loadSequence() {
+  SequenceInfo info;
+  if (sequenceData == nullptr ||
+      !parseSequence(sequenceData, sequencePartition->size, info)) {
+    storedSequence = SequenceInfo();
+    return false;
+  }
+  storedSequence = info;
+  Serial.printf("Sequence: %u keyframes, %lu ms\n", info.frameCount,
+                static_cast<unsigned long>(info.durationMs));  // NOLINT(runtime/int)
+  return true;
+}
+
+/**
+ * Map the whole sequence partition into the data address space once. The
+ * mapping stays valid across uploads; flash writes flush the cache for
+ * the range they touch.
+ */
+void mapSequence() {
+  sequencePartition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA,
+      static_cast<esp_partition_subtype_t>(cfg::SEQUENCE_SUBTYPE),
+      cfg::SEQUENCE_LABEL);
+  if (sequencePartition == nullptr)
+    return;
+  const void *ptr;
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(sequencePartition, 0, sequencePartition->size,
+                         SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK)
+    return;
+  sequenceData = static_cast<const uint8_t *>(ptr);
+  loadSequence();
+}
+
+/**
+ * Write @p len uploaded bytes at the current upload offset, erasing
+ * sectors just ahead of the data. The header is held back in RAM so an
+ * interrupted upload leaves no valid sequence behind.
+ */
+bool writeSequenceChunk(const uint8_t *buf, size_t len) {
+  size_t end = sequenceReceived + len;
+  if (end > sequencePartition->size)
+    return false;
+  if (end > sequenceErased) {
+    size_t to = (end + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE *
+                SPI_FLASH_SEC_SIZE;
+    if (esp_partition_erase_range(sequencePartition, sequenceErased,
+                                  to - sequenceErased) != ESP_OK)
+      return false;
+    sequenceErased = to;
+  }
+  for (; len > 0 && sequenceReceived < SEQUENCE_HEADER; --len)
+    sequenceHeader[sequenceReceived++] = *buf++;
+  if (len > 0 && esp_partition_write(sequencePartition, sequenceReceived,
+                                     buf, len) != ESP_OK)
+    return false;
+  sequenceReceived += len;
+  return true;
+}
+
+/** Receive a sequence into its partition; runs in the HTTP task */
+void handleSequenceUpload() {
+  HTTPUpload &up = server.upload();
+  if (up.status == UPLOAD_FILE_START) {
+    // Stop reading the partition before its sectors get erased
+    HttpCall call;
+    call.run = [](HttpCall &) {
+      storedSequence = SequenceInfo();
+      if (sequenceActive) {
+        sequenceActive = false;
+        applyPreset();
+      }
+    };
+    callControl(call);
+    sequenceReceived = 0;
+    sequenceErased = 0;
+    sequenceUploadOk = sequencePartition != nullptr;
+  } else if (up.status == UPLOAD_FILE_WRITE) {
+    if (sequenceUploadOk)
+      sequenceUploadOk = writeSequenceChunk(up.buf, up.currentSize);
+  } else if (up.status == UPLOAD_FILE_END) {
+    // Only a complete sequence gets its header
+    sequenceUploadOk =
+        sequenceUploadOk && sequenceReceived >= SEQUENCE_HEADER &&
+        sequenceSize(sequenceHeader) == sequenceReceived &&
+        esp_partition_write(sequencePartition, 0, sequenceHeader,
+                            SEQUENCE_HEADER) == ESP_OK;
+  } else if (up.status == UPLOAD_FILE_ABORTED) {
+    sequenceUploadOk = false;
+  }
+}
+
+/** Load the uploaded sequence and start playing it */
+void handleSequenceResult() {
+  HttpCall call;
+  call.ok = sequenceUploadOk;
+  call.run = [](HttpCall &c) {
+    // Also reloads the previous sequence if the upload never touched it
+    bool loaded = loadSequence();
+    c.ok = c.ok && loaded;
+    if (c.ok)
+      pending.sequence = true;
+  };
+  callControl(call);
+  server.send(call.ok ? 200 : 400, "text/plain",
+              call.ok ? "OK" : "Invalid sequence");
+}
+
+/**
+ * Copy a streamed LED frame into the live buffer and show it.
+ * Frames are not persisted; see LED_FRAME_RGB for the layout.
+ */
+void handleLedFrame(const uint8_t *data, size_t len) {
+  LedFrame frame;
+  if (!parseLedFrame(data, len, frame) || frame.start >= cfg::NUM_LEDS)
+    return;
+  if (!liveActive)
+    fill_solid(liveLeds, cfg::NUM_LEDS, CRGB::Black);
+  size_t count = frame.count;
+  size_t room = cfg::NUM_LEDS - frame.start;
+  if (count > room)
+    count = room;
+  memcpy(&liveLeds[frame.start], frame.rgb, count * 3);
+  liveActive = true;
+  liveLastFrame = millis();
+  requestApply();
+}
+
+/**
+ * Read one pixel packet from @p udp. Only the header is copied; the pixel
+ * bytes are read from the socket directly into liveLeds.
+ */
+void receivePixelPacket(WiFiUDP &udp, size_t size, bool ddp) {
+  uint8_t hdr[E131_HEADER];
+  PixelPacket pkt;
+  bool ok;
+  if (ddp) {
+    ok = size >= DDP_HEADER && udp.read(hdr, DDP_HEADER) == DDP_HEADER &&
+         parseDdpHeader(hdr, size, pkt);
+    if (ok && pkt.headerLen > DDP_HEADER)
+      ok = udp.read(hdr + DDP_HEADER, DDP_TIMECODE) == DDP_TIMECODE;
+  } else {
+    ok = size >= E131_HEADER &&
+         udp.read(hdr, E131_HEADER) == E131_HEADER &&
+         parseE131Header(hdr, size, cfg::E131_UNIVERSE, pkt);
+  }
+  if (!ok || pkt.offset >= sizeof(liveLeds)) {
+    ++udpDropped;
+    return;
+  }
+  ++udpPackets;
+  bool fresh = ddp ? (pkt.sequence == 0 || ddpSequence.accept(pkt.sequence - 1))
+                   : e131Sequence.accept(pkt.sequence);
+  if (!fresh)
+    return;
+  if (!liveActive)
+    fill_solid(liveLeds, cfg::NUM_LEDS, CRGB::Black);
+  size_t count = pkt.dataLen;
+  if (count > sizeof(liveLeds) - pkt.offset)
+    count = sizeof(liveLeds) - pkt.offset;
+  udp.read(reinterpret_cast<uint8_t *>(liveLeds) + pkt.offset, count);
+  liveActive = true;
+  liveLastFrame = millis();
+  // Senders that never push still show once the last LED was written
+  if (pkt.push || pkt.offset + count >= sizeof(liveLeds))
+    requestApply();
+}
+
+/** Drain the DDP and E1.31 sockets, a bounded number of packets each */
+void handleUdp() {
+  for (int i = 0; i < cfg::UDP_PACKETS_PER_LOOP; ++i) {
+    int size = ddpUdp.parsePacket();
+    if (size <= 0)
+      break;
+    receivePixelPacket(ddpUdp, size, true);
+  }
+  for (int i = 0; i < cfg::UDP_PACKETS_PER_LOOP; ++i) {
+    int size = e131Udp.parsePacket();
+    if (size <= 0)
+      break;
+    receivePixelPacket(e131Udp, size, false);
+  }
+}
+
+/** Return to the active preset once the stream has gone quiet */
+void handleLiveTimeout() {
+  if (liveActive && millis() - liveLastFrame > cfg::LIVE_TIMEOUT_MS) {
+    liveActive = false;
+    ddpSequence.reset();
+    e131Sequence.reset();
+    requestApply();
+  }
+}
+
+/** Collect the state WebSocket clients are kept in sync with */
+StateSnapshot captureState() {
+  StateSnapshot st;
+  st.preset = currentPreset;
+  st.hold = holdPreset;
+  st.bright = brightness;
+  st.speed = animInterval;
+  const CRGB &c = presets[currentPreset].color;
+  st.color = (static_cast<uint32_t>(c.r) << 16) |
+             (static_cast<uint32_t>(c.g) << 8) | c.b;
+  st.presetCount = presets.size();
+  st.live = liveActive;
+  return st;
+}
+
+#ifdef USE_BLE
+/** Update the BLE state characteristic and notify subscribed centrals */
+void publishBleState(const StateSnapshot &st) {
+  uint8_t rec[STATE_RECORD_SIZE];
+  encodeStateRecord(st, rec);
+  bleState->setValue(rec, sizeof(rec));
+  if (bleServer->getConnectedCount() > 0)
+    bleState->notify();
+}
+#endif
+
+/**
+ * Broadcast the fields that changed since the last broadcast. Runs at
+ * most once per frame, so a burst of changes becomes a single message.
+ */
+void handleStateBroadcast() {
+  uint32_t now = millis();
+  if (broadcastValid && now - lastBroadcast < controlInterval())
+    return;
+  StateSnapshot cur = captureState();
+  char msg[STATE_DELTA_MAX];
+  size_t len = formatStateDelta(broadcastValid ? &broadcastState : nullptr,
+                                cur, msg, sizeof(msg));
+  broadcastState = cur;
+  broadcastValid = true;
+  if (len == 0)
+    return;
+  lastBroadcast = now;
+  ws.broadcastTXT(msg, len);
+#ifdef USE_BLE
+  if (bleState != nullptr)
+    publishBleState(cur);
+#endif
 }
 
 /**
  * Handle incoming WebSocket messages
  */
 void wsEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t len) {
-  if (type != WStype_TEXT)
+  if (type == WStype_CONNECTED) {
+    // New clients start from the full state and then follow the deltas
+    char msg[STATE_DELTA_MAX];
+    size_t n = formatStateDelta(nullptr, captureState(), msg, sizeof(msg));
+    if (n > 0)
+      ws.sendTXT(num, msg, n);
     return;
-  String msg = String(reinterpret_cast<char *>(payload));
+  }
+  if (type != WStype_TEXT && type != WStype_BIN)
+    return;
+  const char *msg = reinterpret_cast<const char *>(payload);
 #if USE_AUTH
-  String prefix = String(cfg::TOKEN) + ":";
-  if (!msg.startsWith(prefix))
+  if (!stripToken(msg, len, cfg::TOKEN))
     return;
-  msg = msg.substring(prefix.length());
 #endif
-  handleCommand(msg);
+  if (type == WStype_BIN)
+    handleLedFrame(reinterpret_cast<const uint8_t *>(msg), len);
+  else
+    handleCommand(msg, len, num);
+}
+
+#ifdef USE_BLE
+/** Start the GATT control service and advertise it as @p name */
+void startBluetooth(const char *name) {
+  NimBLEDevice::init(name);
+  NimBLEDevice::setMTU(cfg::BLE_MTU);
+  bleServer = NimBLEDevice::createServer();
+  NimBLEService *svc = bleServer->createService(BLE_SERVICE_UUID);
+  for (uint8_t i = 0; i < BLE_FIELD_COUNT; ++i) {
+    NimBLECharacteristic *c = svc->createCharacteristic(
+        BLE_FIELD_UUIDS[i], NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR);
+    c->setCallbacks(&bleCallbacks[i]);
+  }
+  bleState = svc->createCharacteristic(
+      BLE_STATE_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+  publishBleState(captureState());
+  svc->start();
+  NimBLEAdvertising *adv = NimBLEDevice::getAdvertising();
+  adv->addServiceUUID(BLE_SERVICE_UUID);
+  adv->setScanResponse(true);
+  adv->start();
 }
 
 /**
- * Initialize hardware and network services
+ * Run the characteristic writes queued since the last call. They take the
+ * same paths as WebSocket messages, so validation and batching match.
  */
-void setup() {
-  Serial.begin(115200);
-  loadCredentials();
-  loadHoldPreset();
-  const char *btName =
-      storedHostname.length() ? storedHostname.c_str() : DEFAULT_HOST;
-  bt.begin(btName);
-  pinMode(cfg::BTN_PREV, INPUT_PULLUP);
-  // Buttons are active-low. Pins 34-39 do not support internal pull-ups,
-  // so fall back to plain INPUT when necessary.
-  if (cfg::BTN_NEXT >= 34)
-    pinMode(cfg::BTN_NEXT, INPUT);
-  else
-    pinMode(cfg::BTN_NEXT, INPUT_PULLUP);
-  if (cfg::BTN_HOLD >= 34)
-    pinMode(cfg::BTN_HOLD, INPUT);
-  else
-    pinMode(cfg::BTN_HOLD, INPUT_PULLUP);
-  FastLED.addLeds<WS2812, cfg::LED_PIN, GRB>(leds, cfg::NUM_LEDS);
-  FastLED.setBrightness(brightness);
+void handleBluetooth() {
+  BleWrite w;
+  while (bleWrites.pop(w)) {
+    Command cmd;
+    switch (w.field) {
+    case BLE_PRESET:
+      cmd.type = CommandType::SET;
+      cmd.value = w.len > 1 ? static_cast<uint32_t>(w.data[0] | w.data[1] << 8)
+                            : w.data[0];
+      runCommand(cmd, REPLY_BLUETOOTH);
+      break;
+    case BLE_BRIGHTNESS:
+      cmd.type = CommandType::BRIGHT;
+      cmd.value = w.data[0];
+      runCommand(cmd, REPLY_BLUETOOTH);
+      break;
+    case BLE_COLOR:
+      if (w.len != 3)
+        break;
+      cmd.type = CommandType::COLOR;
+      cmd.value = static_cast<uint32_t>(w.data[0]) << 16 |
+                  static_cast<uint32_t>(w.data[1]) << 8 | w.data[2];
+      runCommand(cmd, REPLY_BLUETOOTH);
+      break;
+    case BLE_FRAME:
+      handleLedFrame(w.data, w.len);
+      break;
+    case BLE_COMMAND:
+      handleCommand(reinterpret_cast<const char *>(w.data), w.len,
+                    REPLY_BLUETOOTH);
+      break;
+    default:
+      break;
+    }
+  }
+}
 
-  SPIFFS.begin(true);
-  loadDefaultPresets();
-  loadCustomPresets();
-  {
-    Preset p;
-#if KEEP_NAMES_IN_FLASH
-    p.flashName = reinterpret_cast<const __FlashStringHelper *>(F("Off"));
+bool bluetoothConnected() {
+  return bleServer != nullptr && bleServer->getConnectedCount() > 0;
+}
 #else
-    p.name = "Off";
+/** Start the Serial Port Profile server as @p name */
+void startBluetooth(const char *name) { bt.begin(name); }
+
+/**
+ * Consume whatever Bluetooth bytes are buffered and run complete lines.
+ * Never waits for more data, so a partial line can't stall loop().
+ */
+void handleBluetooth() {
+  for (int n = 0; n < cfg::BT_BYTES_PER_LOOP && bt.available(); ++n) {
+    int c = bt.read();
+    if (c < 0)
+      break;
+    if (btLine.push(static_cast<char>(c)))
+      handleCommand(btLine.line(), btLine.length(), REPLY_BLUETOOTH);
+  }
+}
+
+bool bluetoothConnected() { return bt.hasClient(); }
 #endif
-    p.type = PresetType::STATIC;
-    p.color = CRGB::Black;
-    presets.push_back(p);
+
+/** Record a button edge; runs in interrupt context */
+void IRAM_ATTR onButtonEdge(void *arg) {
+  uint8_t id = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(arg));
+  ButtonEvent ev;
+  ev.button = id;
+  ev.pressed = digitalRead(BUTTON_PINS[id]) == LOW;
+  ev.time = millis();
+  if (!buttonEvents.push(ev))
+    buttonOverflow.store(true, std::memory_order_relaxed);
+  if (loopTaskHandle) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(loopTaskHandle, &woken);
+    if (woken)
+      portYIELD_FROM_ISR();
+  }
+}
+
+/** React to a debounced press or release */
+void onButtonChange(uint8_t id, bool pressed) {
+  switch (id) {
+  case BUTTON_PREV:
+    if (pressed)
+      previousPreset();
+    break;
+  case BUTTON_NEXT:
+    if (pressed)
+      nextPreset();
+    break;
+  case BUTTON_HOLD:
+    if (pressed) {
+      savedPreset = targetPreset();
+      if (holdPreset >= 0 &&
+          static_cast<size_t>(holdPreset) < presets.size())
+        requestPreset(holdPreset);
+    } else if (savedPreset != -1) {
+      requestPreset(savedPreset);
+      savedPreset = -1;
+    }
+    break;
   }
-  currentPreset = presets.size() - 1;
+}
+
+/**
+ * Drain the button edges queued by onButtonEdge() and debounce them on
+ * their timestamps, so presses are seen even if loop() was busy.
+ */
+void handleButtons() {
+  ButtonEvent ev;
+  while (buttonEvents.pop(ev)) {
+    if (buttons[ev.button].edge(ev.pressed, ev.time))
+      onButtonChange(ev.button, ev.pressed);
+  }
+  uint32_t now = millis();
+  if (buttonOverflow.exchange(false, std::memory_order_relaxed)) {
+    for (uint8_t i = 0; i < BUTTON_COUNT; ++i) {
+      if (buttons[i].edge(digitalRead(BUTTON_PINS[i]) == LOW, now))
+        onButtonChange(i, buttons[i].pressed());
+    }
+  }
+  for (uint8_t i = 0; i < BUTTON_COUNT; ++i) {
+    if (buttons[i].poll(now))
+      onButtonChange(i, buttons[i].pressed());
+  }
+}
+
+/**
+ * True while the output is a still frame nobody is interacting with:
+ * a static or custom preset (including "Off"), no stream, no clients
+ * and no control change for cfg::IDLE_AFTER_MS.
+ */
+bool canIdle() {
+  if (liveActive || pending.preset >= 0 || pending.publish)
+    return false;
+  if (effectFor(presets[currentPreset].type).animated || sequenceActive)
+    return false;
+  if (startup != Startup::DONE)
+    return false;
+  if (ws.connectedClients() > 0 || bluetoothConnected())
+    return false;
+  if (wifiState == WifiState::CONNECTING || restartPending)
+    return false;
+  // The modem must stay awake to hear the sync leader
+  if (syncRole == SyncRole::FOLLOWER)
+    return false;
+  return millis() - lastActivity > cfg::IDLE_AFTER_MS;
+}
 
-  connectWiFi();
+/**
+ * Lower the CPU clock and let the WiFi modem sleep between beacons while
+ * idle; restore full speed as soon as anything happens.
+ */
+void handlePower() {
+  bool idle = canIdle();
+  if (idle == powerIdle)
+    return;
+  powerIdle = idle;
+  if (idle) {
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+    setCpuFrequencyMhz(cfg::IDLE_CPU_MHZ);
+    cpuMhz = cfg::IDLE_CPU_MHZ;
+  } else {
+    setCpuFrequencyMhz(cfg::ACTIVE_CPU_MHZ);
+    cpuMhz = cfg::ACTIVE_CPU_MHZ;
+    WiFi.setSleep(WIFI_PS_MIN_MODEM);
+  }
+}
 
-  server.on("/", handleRoot);
+/**
+ * Register strip @p I of the topology and the ones after it, each on its
+ * own pin and so its own RMT channel, backed by its slice of `leds`.
+ */
+template <size_t I = 0>
+typename std::enable_if<I == topology::STRIP_COUNT>::type addStrips() {}
+
+template <size_t I = 0>
+typename std::enable_if<(I < topology::STRIP_COUNT)>::type addStrips() {
+  FastLED.addLeds<WS2812, topology::STRIPS[I].pin, GRB>(
+      leds + stripOffset(topology::STRIPS, I), topology::STRIPS[I].count);
+  addStrips<I + 1>();
+}
+
+/** Serve HTTP clients on the protocol core */
+void httpTask(void *) {
+  for (;;) {
+    server.handleClient();
+    vTaskDelay(pdMS_TO_TICKS(cfg::HTTP_POLL_MS));
+  }
+}
+
+/** Register the HTTP routes and start the servers */
+void startServers() {
+  for (size_t i = 0; i < WEB_ASSET_COUNT; ++i) {
+    const WebAsset &asset = WEB_ASSETS[i];
+    server.on(asset.path, HTTP_GET, [&asset]() { serveAsset(asset); });
+  }
+  static const char *ETAG_HEADERS[] = {"If-None-Match"};
+  server.collectHeaders(ETAG_HEADERS, 1);
+  server.on("/api/state", HTTP_GET, handleApiState);
+  server.on("/metrics", HTTP_GET, handleMetrics);
   server.on("/add", HTTP_POST, handleAdd);
   server.on("/set", HTTP_GET, handleSet);
   server.on("/hold", HTTP_GET, handleHold);
@@ -1034,79 +2746,155 @@ void setup() {
   server.on("/wifi", HTTP_POST, handleWifiSave);
   server.on("/update", HTTP_GET, handleUpdateForm);
   server.on("/update", HTTP_POST, handleUpdateResult, handleUpdateUpload);
+  server.on("/sequence", HTTP_POST, handleSequenceResult,
+            handleSequenceUpload);
   server.begin();
 
   ws.begin();
   ws.onEvent(wsEvent);
+  ddpUdp.begin(DDP_PORT);
+  e131Udp.begin(E131_PORT);
 
   ArduinoOTA.begin();
 
-  applyPreset();
+  xTaskCreatePinnedToCore(httpTask, "http", cfg::HTTP_STACK, nullptr,
+                          cfg::HTTP_PRIORITY, &httpTaskHandle, cfg::HTTP_CORE);
 }
 
 /**
- * Main execution loop
+ * Bring up the deferred services, one per call, so buttons and the
+ * control path keep running in between. Called from loop().
  */
-void loop() {
-  static bool lastBtnPrev = HIGH;
-  static bool lastBtnNext = HIGH;
-  static bool lastBtnHold = HIGH;
-  static uint32_t lastDebounce = 0;
-  static wl_status_t lastWiFiStatus = WL_IDLE_STATUS;
-  const uint32_t debounceDelay = 50;
-
-  bool btnPrev = digitalRead(cfg::BTN_PREV) == LOW;
-  bool btnNext = digitalRead(cfg::BTN_NEXT) == LOW;
-  bool btnHold = digitalRead(cfg::BTN_HOLD) == LOW;
-
-  wl_status_t status = WiFi.status();
-  if (status != lastWiFiStatus) {
-    if (status == WL_DISCONNECTED && !wifiConnecting) {
-      Serial.println("\nWiFi disconnected, reconnecting...");
-      delay(500);
-      connectWiFi();
-    }
-    lastWiFiStatus = status;
+void handleStartup() {
+  switch (startup) {
+  case Startup::NETWORK:
+    connectWiFi();
+    startSync();
+    startup = Startup::SERVERS;
+    break;
+  case Startup::SERVERS:
+    startServers();
+    startup = Startup::BLUETOOTH;
+    break;
+  case Startup::BLUETOOTH:
+    startBluetooth(storedHostname.length() ? storedHostname.c_str()
+                                           : DEFAULT_HOST);
+    startup = Startup::DONE;
+    Serial.printf("Startup done after %lu ms\n",
+                  static_cast<unsigned long>(millis()));  // NOLINT(runtime/int)
+    break;
+  case Startup::DONE:
+    break;
   }
+}
 
-  handleWiFi();
+/**
+ * Initialize hardware. The LEDs show the last-used preset from the boot
+ * record before anything slow runs; the preset store follows, and WiFi,
+ * the servers and Bluetooth are started from loop() by handleStartup().
+ */
+void setup() {
+  Serial.begin(115200);
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
 
-  if (millis() - lastDebounce > debounceDelay) {
-    if (btnPrev && !lastBtnPrev)
-      previousPreset();
-    if (btnNext && !lastBtnNext)
-      nextPreset();
-    if (btnHold && !lastBtnHold) {
-      savedPreset = currentPreset;
-      if (holdPreset >= 0 && holdPreset < presets.size()) {
-        currentPreset = holdPreset;
-        applyPreset();
-      }
-    }
-    if (!btnHold && lastBtnHold && savedPreset != -1) {
-      currentPreset = savedPreset;
-      savedPreset = -1;
-      applyPreset();
+  // First light
+  addStrips();
+  FastLED.setBrightness(brightness);
+  int bootPreset = -1;
+  {
+    Preset p;
+    BootState st;
+    if (loadBootRecord(p, st)) {
+      brightness = st.brightness;
+      animInterval = st.stepMs;
+      bootPreset = st.preset;
+      publishState(p, bootPreset);
     }
-    lastDebounce = millis();
   }
+  xTaskCreatePinnedToCore(renderTask, "render", cfg::RENDER_STACK, nullptr,
+                          cfg::RENDER_PRIORITY, &renderTaskHandle,
+                          cfg::RENDER_CORE);
+  Serial.printf("First light after %lu ms\n",
+                static_cast<unsigned long>(millis()));  // NOLINT(runtime/int)
 
-  lastBtnPrev = btnPrev;
-  lastBtnNext = btnNext;
-  lastBtnHold = btnHold;
+  // Controls and presets
+  pinMode(cfg::BTN_PREV, INPUT_PULLUP);
+  // Buttons are active-low. Pins 34-39 do not support internal pull-ups,
+  // so fall back to plain INPUT when necessary.
+  if (cfg::BTN_NEXT >= 34)
+    pinMode(cfg::BTN_NEXT, INPUT);
+  else
+    pinMode(cfg::BTN_NEXT, INPUT_PULLUP);
+  if (cfg::BTN_HOLD >= 34)
+    pinMode(cfg::BTN_HOLD, INPUT);
+  else
+    pinMode(cfg::BTN_HOLD, INPUT_PULLUP);
+  for (uint8_t i = 0; i < BUTTON_COUNT; ++i)
+    attachInterruptArg(digitalPinToInterrupt(BUTTON_PINS[i]), onButtonEdge,
+                       reinterpret_cast<void *>(static_cast<uintptr_t>(i)),
+                       CHANGE);
+  loadSettings();
 
-  server.handleClient();
-  ws.loop();
-  if (bt.available()) {
-    String line = bt.readStringUntil('\n');
-    line.trim();
-    if (line.length())
-      handleCommand(line);
+  SPIFFS.begin(true);
+  mapSequence();
+  loadDefaultPresets();
+  bool legacyPresets = loadCustomPresets();
+  {
+    Preset p;
+    p.flashName = F("Off");
+    p.type = PresetType::STATIC;
+    p.color = CRGB::Black;
+    presets.push_back(std::move(p));
   }
-  ArduinoOTA.handle();
+  if (legacyPresets)
+    finishPresetMigration();
+  // The same index and type keep the running effect going without a jump
+  if (bootPreset >= 0 && static_cast<size_t>(bootPreset) < presets.size())
+    currentPreset = bootPreset;
+  else
+    currentPreset = presets.size() - 1;
+  applyPreset();
+}
 
-  if (millis() - lastAnim > animInterval) {
-    applyPreset();
-    lastAnim = millis();
+/**
+ * Main execution loop
+ */
+void loop() {
+  uint32_t loopStart = ESP.getCycleCount();
+  uint32_t t = loopStart;
+  handleStartup();
+  handleWiFi();
+  t = endStage(STAGE_WIFI, t);
+  handleButtons();
+  t = endStage(STAGE_BUTTONS, t);
+  handleHttpCalls();
+  t = endStage(STAGE_HTTP, t);
+  if (startup > Startup::SERVERS) {
+    ws.loop();
+    t = endStage(STAGE_WS, t);
+    handleUdp();
+    t = endStage(STAGE_UDP, t);
+  }
+  handleSync();
+  t = endStage(STAGE_SYNC, t);
+  if (startup == Startup::DONE) {
+    handleBluetooth();
+    t = endStage(STAGE_BLUETOOTH, t);
   }
+  handleLiveTimeout();
+  applyPendingControl();
+  t = endStage(STAGE_APPLY, t);
+  handlePresetPersistence();
+  t = endStage(STAGE_PERSIST, t);
+  handleStateBroadcast();
+  handleUpdateProgress();
+  endStage(STAGE_BROADCAST, t);
+  if (startup > Startup::SERVERS)
+    ArduinoOTA.handle();
+  handleDeferredRestart();
+  handlePower();
+  endStage(STAGE_LOOP, loopStart);
+  // Sleep instead of spinning while idle; a button edge wakes us at once
+  if (powerIdle)
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(cfg::IDLE_LOOP_MS));
 }
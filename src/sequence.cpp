@@ -0,0 +1,118 @@
+// Copyright 2025 Bootj05
+//
+// Licensed under the MIT License.
+#include "sequence.h"
+
+#include "effects.h"
+
+namespace {
+
+inline uint16_t readLe16(const uint8_t *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+}  // namespace
+
+size_t sequenceSize(const uint8_t *header) {
+  if (header == nullptr || header[0] != SEQUENCE_MAGIC ||
+      header[1] != SEQUENCE_VERSION)
+    return 0;
+  uint16_t ledCount = readLe16(header + 4);
+  uint16_t frameCount = readLe16(header + 6);
+  if (ledCount == 0 || ledCount > EFFECT_MAX_LEDS || frameCount == 0)
+    return 0;
+  // 64-bit math so a crafted header can't wrap a 32-bit size_t
+  uint64_t size = static_cast<uint64_t>(frameCount) *
+                  sequenceFrameSize(ledCount) + SEQUENCE_HEADER;
+  return size > SIZE_MAX ? 0 : static_cast<size_t>(size);
+}
+
+bool parseSequence(const uint8_t *data, size_t len, SequenceInfo &info) {
+  if (data == nullptr || len < SEQUENCE_HEADER)
+    return false;
+  size_t size = sequenceSize(data);
+  if (size == 0 || size > len)
+    return false;
+  SequenceInfo seq;
+  seq.frames = data + SEQUENCE_HEADER;
+  seq.ledCount = readLe16(data + 4);
+  seq.frameCount = readLe16(data + 6);
+  seq.loop = (data[2] & SEQUENCE_FLAG_LOOP) != 0;
+  size_t frameSize = sequenceFrameSize(seq.ledCount);
+  for (uint16_t i = 0; i < seq.frameCount; ++i)
+    seq.durationMs += readLe16(seq.frames + i * frameSize);
+  // Playback would never get past a loop of zero length
+  if (seq.loop && seq.durationMs == 0)
+    return false;
+  info = seq;
+  return true;
+}
+
+SequencePlayer::SequencePlayer()
+    : seq_(), index_(0), frameStart_(0), playing_(false), drawn_(false) {}
+
+void SequencePlayer::start(const SequenceInfo &seq, uint32_t now) {
+  seq_ = seq;
+  index_ = 0;
+  frameStart_ = now;
+  playing_ = seq.frames != nullptr;
+  drawn_ = false;
+}
+
+const uint8_t *SequencePlayer::frame(uint16_t index) const {
+  return seq_.frames + index * sequenceFrameSize(seq_.ledCount);
+}
+
+uint16_t SequencePlayer::duration(uint16_t index) const {
+  return readLe16(frame(index));
+}
+
+void SequencePlayer::advance(uint32_t now) {
+  uint32_t elapsed = now - frameStart_;
+  // A whole pass ends on the same keyframe, so skip passes at once
+  if (seq_.loop && elapsed >= seq_.durationMs) {
+    uint32_t skip = elapsed - elapsed % seq_.durationMs;
+    frameStart_ += skip;
+    elapsed -= skip;
+  }
+  for (;;) {
+    if (!seq_.loop && index_ + 1U == seq_.frameCount) {
+      playing_ = false;
+      return;
+    }
+    uint16_t d = duration(index_);
+    if (elapsed < d)
+      return;
+    frameStart_ += d;
+    elapsed -= d;
+    index_ = index_ + 1U == seq_.frameCount ? 0 : index_ + 1U;
+  }
+}
+
+bool SequencePlayer::render(CRGB *out, uint16_t count, uint32_t now) {
+  if (seq_.frames == nullptr)
+    return false;
+  if (playing_)
+    advance(now);
+  if (!playing_ && drawn_)
+    return false;
+  const uint8_t *from = frame(index_) + 2;
+  const uint8_t *to = from;
+  uint8_t amount = 0;
+  if (playing_) {
+    uint16_t next = index_ + 1U == seq_.frameCount ? 0 : index_ + 1U;
+    to = frame(next) + 2;
+    amount = crossfadeAmount(now - frameStart_, duration(index_));
+  }
+  uint16_t n = count < seq_.ledCount ? count : seq_.ledCount;
+  for (uint16_t i = 0; i < n; ++i) {
+    const uint8_t *a = from + 3 * i;
+    const uint8_t *b = to + 3 * i;
+    out[i] = CRGB(a[0], a[1], a[2]);
+    nblend(out[i], CRGB(b[0], b[1], b[2]), amount);
+  }
+  for (uint16_t i = n; i < count; ++i)
+    out[i] = CRGB::Black;
+  drawn_ = !playing_;
+  return true;
+}
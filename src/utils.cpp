@@ -4,17 +4,16 @@
 #include "utils.h"
 
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
 
-bool parseHexColor(const char *hex, uint32_t &value) {
-    if (hex == nullptr) {
+bool parseHexColor(const char *hex, size_t len, uint32_t &value) {
+    if (hex == nullptr || len != 6U) {
         return false;
     }
     uint32_t result = 0U;
     for (size_t i = 0U; i < 6U; ++i) {
         char c = hex[i];
-        if (c == '\0') {
-            return false;
-        }
         result <<= 4U;
         if (c >= '0' && c <= '9') {
             result |= static_cast<uint32_t>(c - '0');
@@ -26,9 +25,756 @@ bool parseHexColor(const char *hex, uint32_t &value) {
             return false;
         }
     }
-    if (hex[6] != '\0') {
+    value = result;
+    return true;
+}
+
+bool parseHexColor(const char *hex, uint32_t &value) {
+    if (hex == nullptr) {
+        return false;
+    }
+    size_t len = 0U;
+    while (len < 7U && hex[len] != '\0') {
+        ++len;
+    }
+    return parseHexColor(hex, len, value);
+}
+
+// Match "<name>" exactly or "<name>:" as a prefix, leaving the argument
+static bool matchCommand(const char *msg, size_t len, const char *name,
+                         bool hasArg, const char *&arg, size_t &argLen) {
+    size_t n = strlen(name);
+    if (len < n || memcmp(msg, name, n) != 0) {
+        return false;
+    }
+    if (!hasArg) {
+        return len == n;
+    }
+    if (len == n || msg[n] != ':') {
+        return false;
+    }
+    arg = msg + n + 1U;
+    argLen = len - n - 1U;
+    return true;
+}
+
+// Digits only, at most 9 of them so the value fits comfortably
+static bool parseDecimal(const char *s, size_t len, uint32_t &value) {
+    if (len == 0U || len > 9U) {
         return false;
     }
+    uint32_t result = 0U;
+    for (size_t i = 0U; i < len; ++i) {
+        if (s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+        result = result * 10U + static_cast<uint32_t>(s[i] - '0');
+    }
     value = result;
     return true;
 }
+
+static bool parseLedList(const char *s, size_t len, Command &cmd) {
+    size_t count = 0U;
+    size_t pos = 0U;
+    while (pos < len) {
+        if (count == Command::MAX_LEDS) {
+            return false;
+        }
+        size_t end = pos;
+        while (end < len && s[end] != ',') {
+            ++end;
+        }
+        size_t start = pos;
+        if (start < end && s[start] == '#') {
+            ++start;
+        }
+        if (!parseHexColor(s + start, end - start, cmd.leds[count])) {
+            return false;
+        }
+        ++count;
+        pos = end + 1U;
+    }
+    cmd.ledCount = count;
+    return true;
+}
+
+bool parseCommand(const char *msg, size_t len, Command &cmd) {
+    cmd.type = CommandType::UNKNOWN;
+    cmd.value = 0U;
+    cmd.ledCount = 0U;
+    if (msg == nullptr) {
+        return false;
+    }
+    const char *arg = nullptr;
+    size_t argLen = 0U;
+    uint32_t val = 0U;
+    CommandType type = CommandType::UNKNOWN;
+    if (matchCommand(msg, len, "next", false, arg, argLen)) {
+        type = CommandType::NEXT;
+    } else if (matchCommand(msg, len, "prev", false, arg, argLen)) {
+        type = CommandType::PREV;
+    } else if (matchCommand(msg, len, "set", true, arg, argLen)) {
+        if (!parseDecimal(arg, argLen, val)) {
+            return false;
+        }
+        type = CommandType::SET;
+    } else if (matchCommand(msg, len, "bright", true, arg, argLen)) {
+        if (!parseDecimal(arg, argLen, val) || val > 255U) {
+            return false;
+        }
+        type = CommandType::BRIGHT;
+    } else if (matchCommand(msg, len, "color", true, arg, argLen)) {
+        if (argLen != 7U || arg[0] != '#' ||
+            !parseHexColor(arg + 1, 6U, val)) {
+            return false;
+        }
+        type = CommandType::COLOR;
+    } else if (matchCommand(msg, len, "speed", true, arg, argLen)) {
+        if (!parseDecimal(arg, argLen, val) || val == 0U || val > 0xFFFFU) {
+            return false;
+        }
+        type = CommandType::SPEED;
+    } else if (matchCommand(msg, len, "frame", true, arg, argLen)) {
+        if (!parseDecimal(arg, argLen, val) || val == 0U ||
+            val > MAX_FRAME_MS) {
+            return false;
+        }
+        type = CommandType::FRAME;
+    } else if (matchCommand(msg, len, "fade", true, arg, argLen)) {
+        if (!parseDecimal(arg, argLen, val) || val > MAX_FADE_MS) {
+            return false;
+        }
+        type = CommandType::FADE;
+    } else if (matchCommand(msg, len, "leds", true, arg, argLen)) {
+        if (!parseLedList(arg, argLen, cmd)) {
+            cmd.ledCount = 0U;
+            return false;
+        }
+        type = CommandType::LEDS;
+    } else if (matchCommand(msg, len, "save", false, arg, argLen)) {
+        type = CommandType::SAVE;
+    } else if (matchCommand(msg, len, "stats", false, arg, argLen)) {
+        type = CommandType::STATS;
+    } else if (matchCommand(msg, len, "sync", true, arg, argLen)) {
+        static const char *const ROLES[] = {"off", "leader", "follower"};
+        val = sizeof(ROLES) / sizeof(ROLES[0]);
+        for (uint32_t i = 0; i < sizeof(ROLES) / sizeof(ROLES[0]); ++i) {
+            if (argLen == strlen(ROLES[i]) &&
+                memcmp(arg, ROLES[i], argLen) == 0) {
+                val = i;
+            }
+        }
+        if (val == sizeof(ROLES) / sizeof(ROLES[0])) {
+            return false;
+        }
+        type = CommandType::SYNC;
+    } else if (matchCommand(msg, len, "play", false, arg, argLen)) {
+        type = CommandType::PLAY;
+    } else {
+        return false;
+    }
+    cmd.type = type;
+    cmd.value = val;
+    return true;
+}
+
+bool stripToken(const char *&msg, size_t &len, const char *token) {
+    if (msg == nullptr || token == nullptr) {
+        return false;
+    }
+    size_t n = strlen(token);
+    if (len <= n || memcmp(msg, token, n) != 0 || msg[n] != ':') {
+        return false;
+    }
+    msg += n + 1U;
+    len -= n + 1U;
+    return true;
+}
+
+bool parseLedFrame(const uint8_t *data, size_t len, LedFrame &frame) {
+    if (data == nullptr || len <= LED_FRAME_HEADER ||
+        data[0] != LED_FRAME_RGB) {
+        return false;
+    }
+    size_t bytes = len - LED_FRAME_HEADER;
+    if (bytes % 3U != 0U || bytes / 3U > 0xFFFFU) {
+        return false;
+    }
+    frame.start = static_cast<uint16_t>((data[1] << 8) | data[2]);
+    frame.count = static_cast<uint16_t>(bytes / 3U);
+    frame.rgb = data + LED_FRAME_HEADER;
+    return true;
+}
+
+static uint16_t readBe16(const uint8_t *p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static uint32_t readBe32(const uint8_t *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+bool parseDdpHeader(const uint8_t *hdr, size_t packetLen, PixelPacket &out) {
+    static const uint8_t VERSION_MASK = 0xC0U;
+    static const uint8_t VERSION_1 = 0x40U;
+    static const uint8_t FLAG_TIMECODE = 0x10U;
+    static const uint8_t FLAG_QUERY_REPLY_STORAGE = 0x0EU;
+    static const uint8_t FLAG_PUSH = 0x01U;
+    static const uint8_t ID_DISPLAY = 0x01U;
+    if (hdr == nullptr || packetLen < DDP_HEADER) {
+        return false;
+    }
+    uint8_t flags = hdr[0];
+    uint8_t type = hdr[2];
+    if ((flags & VERSION_MASK) != VERSION_1 ||
+        (flags & FLAG_QUERY_REPLY_STORAGE) != 0U || hdr[3] != ID_DISPLAY) {
+        return false;
+    }
+    // Undefined, legacy "RGB" or RGB with 8 bits per channel
+    if (type != 0x00U && type != 0x01U && type != 0x0BU) {
+        return false;
+    }
+    out.headerLen = DDP_HEADER + ((flags & FLAG_TIMECODE) ? DDP_TIMECODE : 0U);
+    if (packetLen < out.headerLen) {
+        return false;
+    }
+    out.offset = readBe32(hdr + 4);
+    size_t declared = readBe16(hdr + 8);
+    size_t present = packetLen - out.headerLen;
+    out.dataLen = declared < present ? declared : present;
+    out.sequence = hdr[1] & 0x0FU;
+    out.push = (flags & FLAG_PUSH) != 0U;
+    return true;
+}
+
+bool parseE131Header(const uint8_t *hdr, size_t packetLen, uint16_t universe,
+                     PixelPacket &out) {
+    static const uint8_t ACN_ID[12] = {'A', 'S', 'C', '-', 'E', '1',
+                                       '.', '1', '7', 0, 0, 0};
+    static const uint8_t OPTION_PREVIEW = 0x80U;
+    static const uint8_t OPTION_TERMINATED = 0x40U;
+    if (hdr == nullptr || packetLen < E131_HEADER) {
+        return false;
+    }
+    if (readBe16(hdr) != 0x0010U || readBe16(hdr + 2) != 0U ||
+        memcmp(hdr + 4, ACN_ID, sizeof(ACN_ID)) != 0 ||
+        readBe32(hdr + 18) != 0x00000004UL ||   // Root: E1.31 data
+        readBe32(hdr + 40) != 0x00000002UL) {   // Framing: DMP data
+        return false;
+    }
+    if ((hdr[112] & (OPTION_PREVIEW | OPTION_TERMINATED)) != 0U ||
+        readBe16(hdr + 113) != universe) {
+        return false;
+    }
+    uint16_t properties = readBe16(hdr + 123);
+    if (hdr[117] != 0x02U || hdr[118] != 0xA1U || readBe16(hdr + 119) != 0U ||
+        readBe16(hdr + 121) != 1U || properties == 0U || hdr[125] != 0U) {
+        return false;
+    }
+    size_t declared = properties - 1U;  // Without the start code
+    size_t present = packetLen - E131_HEADER;
+    out.headerLen = E131_HEADER;
+    out.offset = 0U;
+    out.dataLen = declared < present ? declared : present;
+    out.sequence = hdr[111];
+    out.push = true;
+    return true;
+}
+
+SequenceCheck::SequenceCheck(uint16_t modulus, uint16_t window)
+    : modulus_(modulus), window_(window), last_(0U), valid_(false),
+      lost_(0U), late_(0U) {}
+
+bool SequenceCheck::accept(uint16_t seq) {
+    seq %= modulus_;
+    if (!valid_) {
+        valid_ = true;
+        last_ = seq;
+        return true;
+    }
+    uint16_t behind =
+        static_cast<uint16_t>((last_ + modulus_ - seq) % modulus_);
+    if (behind <= window_) {
+        ++late_;
+        return false;
+    }
+    uint16_t ahead = static_cast<uint16_t>(modulus_ - behind);
+    lost_ += ahead - 1U;
+    last_ = seq;
+    return true;
+}
+
+static void writeLe16(uint8_t *p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void writeLe32(uint8_t *p, uint32_t v) {
+    writeLe16(p, static_cast<uint16_t>(v));
+    writeLe16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+static uint16_t readLe16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t readLe32(const uint8_t *p) {
+    return readLe16(p) | (static_cast<uint32_t>(readLe16(p + 2)) << 16);
+}
+
+void encodeSyncMessage(const SyncMessage &msg, uint8_t *out) {
+    out[0] = SYNC_MAGIC;
+    out[1] = SYNC_VERSION;
+    out[2] = msg.group;
+    out[3] = msg.brightness;
+    writeLe16(out + 4, msg.preset);
+    writeLe16(out + 6, msg.stepMs);
+    writeLe32(out + 8, msg.time);
+    writeLe32(out + 12, msg.phase);
+}
+
+bool decodeSyncMessage(const uint8_t *data, size_t len, uint8_t group,
+                       SyncMessage &msg) {
+    if (data == nullptr || len != SYNC_MESSAGE_SIZE ||
+        data[0] != SYNC_MAGIC || data[1] != SYNC_VERSION ||
+        data[2] != group) {
+        return false;
+    }
+    msg.group = data[2];
+    msg.brightness = data[3];
+    msg.preset = readLe16(data + 4);
+    msg.stepMs = readLe16(data + 6);
+    msg.time = readLe32(data + 8);
+    msg.phase = readLe32(data + 12);
+    return true;
+}
+
+ClockSync::ClockSync(uint32_t windowMs)
+    : windowMs_(windowMs), offset_(0U), sampledAt_(0U), valid_(false) {}
+
+void ClockSync::sample(uint32_t remote, uint32_t local) {
+    uint32_t offset = remote - local;
+    // A larger offset means the message spent less time in transit
+    if (!valid_ || static_cast<int32_t>(offset - offset_) >= 0 ||
+        local - sampledAt_ > windowMs_) {
+        offset_ = offset;
+        sampledAt_ = local;
+        valid_ = true;
+    }
+}
+
+void writePresetStoreHeader(uint8_t *out, uint16_t count, uint8_t ledCount) {
+    uint16_t recordSize = static_cast<uint16_t>(presetRecordSize(ledCount));
+    out[0] = static_cast<uint8_t>(PRESET_STORE_MAGIC & 0xFFU);
+    out[1] = static_cast<uint8_t>((PRESET_STORE_MAGIC >> 8) & 0xFFU);
+    out[2] = static_cast<uint8_t>((PRESET_STORE_MAGIC >> 16) & 0xFFU);
+    out[3] = static_cast<uint8_t>((PRESET_STORE_MAGIC >> 24) & 0xFFU);
+    out[4] = PRESET_STORE_VERSION;
+    out[5] = ledCount;
+    out[6] = static_cast<uint8_t>(recordSize & 0xFFU);
+    out[7] = static_cast<uint8_t>(recordSize >> 8);
+    out[8] = static_cast<uint8_t>(count & 0xFFU);
+    out[9] = static_cast<uint8_t>(count >> 8);
+    out[10] = 0U;
+    out[11] = 0U;
+}
+
+bool readPresetStoreHeader(const uint8_t *in, size_t len, uint16_t &count,
+                           uint8_t &ledCount) {
+    if (in == nullptr || len < PRESET_STORE_HEADER) {
+        return false;
+    }
+    uint32_t magic = static_cast<uint32_t>(in[0]) |
+                     (static_cast<uint32_t>(in[1]) << 8) |
+                     (static_cast<uint32_t>(in[2]) << 16) |
+                     (static_cast<uint32_t>(in[3]) << 24);
+    if (magic != PRESET_STORE_MAGIC || in[4] != PRESET_STORE_VERSION) {
+        return false;
+    }
+    uint16_t recordSize = static_cast<uint16_t>(in[6] | (in[7] << 8));
+    if (recordSize != presetRecordSize(in[5])) {
+        return false;
+    }
+    ledCount = in[5];
+    count = static_cast<uint16_t>(in[8] | (in[9] << 8));
+    return true;
+}
+
+void writeBootRecordHeader(uint8_t *out, const BootState &st,
+                           uint8_t ledCount) {
+    out[0] = BOOT_RECORD_MAGIC;
+    out[1] = BOOT_RECORD_VERSION;
+    out[2] = ledCount;
+    out[3] = st.brightness;
+    writeLe16(out + 4, st.preset);
+    writeLe16(out + 6, st.stepMs);
+}
+
+bool readBootRecordHeader(const uint8_t *in, size_t len, uint8_t ledCount,
+                          BootState &st) {
+    if (in == nullptr ||
+        len != BOOT_RECORD_HEADER + presetRecordSize(ledCount) ||
+        in[0] != BOOT_RECORD_MAGIC || in[1] != BOOT_RECORD_VERSION ||
+        in[2] != ledCount) {
+        return false;
+    }
+    st.brightness = in[3];
+    st.preset = readLe16(in + 4);
+    st.stepMs = readLe16(in + 6);
+    return st.stepMs != 0U;
+}
+
+size_t splitTemplate(const char *tpl, const char *const *markers,
+                     size_t markerCount, TemplateSegment *out,
+                     size_t maxSegments) {
+    if (tpl == nullptr || out == nullptr || maxSegments == 0U) {
+        return 0U;
+    }
+    size_t count = 0U;
+    const char *start = tpl;
+    const char *p = tpl;
+    while (*p != '\0') {
+        int found = -1;
+        size_t nameLen = 0U;
+        if (*p == '%') {
+            for (size_t m = 0U; m < markerCount && found < 0; ++m) {
+                size_t n = strlen(markers[m]);
+                if (strncmp(p + 1, markers[m], n) == 0 && p[n + 1] == '%') {
+                    found = static_cast<int>(m);
+                    nameLen = n;
+                }
+            }
+        }
+        if (found < 0) {
+            ++p;
+            continue;
+        }
+        if (count + 1U >= maxSegments) {
+            return 0U;
+        }
+        out[count].text = start;
+        out[count].len = static_cast<size_t>(p - start);
+        out[count].marker = found;
+        ++count;
+        p += nameLen + 2U;
+        start = p;
+    }
+    out[count].text = start;
+    out[count].len = static_cast<size_t>(p - start);
+    out[count].marker = -1;
+    return count + 1U;
+}
+
+size_t formatStateDelta(const StateSnapshot *prev, const StateSnapshot &cur,
+                        char *out, size_t outSize) {
+    if (out == nullptr || outSize < 3U) {
+        return 0U;
+    }
+    size_t len = 0U;
+    bool ok = true;
+    // Appends one ",key:value" pair; the leading comma becomes the brace
+    auto append = [&](const char *fmt, const char *key, long v) {  // NOLINT(runtime/int)
+        if (!ok) {
+            return;
+        }
+        int n = snprintf(out + len, outSize - len, fmt, key, v);
+        if (n < 0 || static_cast<size_t>(n) >= outSize - len) {
+            ok = false;
+            return;
+        }
+        len += static_cast<size_t>(n);
+    };
+    const char *num = ",\"%s\":%ld";
+    if (prev == nullptr || prev->preset != cur.preset) {
+        append(num, "preset", cur.preset);
+    }
+    if (prev == nullptr || prev->hold != cur.hold) {
+        append(num, "hold", cur.hold);
+    }
+    if (prev == nullptr || prev->bright != cur.bright) {
+        append(num, "bright", cur.bright);
+    }
+    if (prev == nullptr || prev->speed != cur.speed) {
+        append(num, "speed", cur.speed);
+    }
+    if (prev == nullptr || prev->color != cur.color) {
+        append(",\"%s\":\"#%06lx\"", "color",
+               static_cast<long>(cur.color & 0xFFFFFFUL));  // NOLINT(runtime/int)
+    }
+    if (prev == nullptr || prev->presetCount != cur.presetCount) {
+        append(num, "count", cur.presetCount);
+    }
+    if (prev == nullptr || prev->live != cur.live) {
+        append(cur.live ? ",\"%s\":true" : ",\"%s\":false", "live", 0);
+    }
+    if (!ok || len == 0U || len + 1U >= outSize) {
+        return 0U;
+    }
+    out[0] = '{';
+    out[len++] = '}';
+    out[len] = '\0';
+    return len;
+}
+
+static uint16_t stateIndex(int32_t index) {
+    return index < 0 || index > 0xFFFE ? 0xFFFFU
+                                       : static_cast<uint16_t>(index);
+}
+
+void encodeStateRecord(const StateSnapshot &st, uint8_t *out) {
+    writeLe16(out, stateIndex(st.preset));
+    writeLe16(out + 2, stateIndex(st.hold));
+    out[4] = st.bright;
+    writeLe16(out + 5, st.speed > 0xFFFFUL ? 0xFFFFU
+                                           : static_cast<uint16_t>(st.speed));
+    out[7] = static_cast<uint8_t>(st.color >> 16);
+    out[8] = static_cast<uint8_t>(st.color >> 8);
+    out[9] = static_cast<uint8_t>(st.color);
+    writeLe16(out + 10, st.presetCount);
+    out[12] = st.live ? STATE_FLAG_LIVE : 0U;
+}
+
+size_t jsonEscape(const char *in, char *out, size_t outSize) {
+    if (out == nullptr || outSize == 0U) {
+        return 0U;
+    }
+    static const char HEX[] = "0123456789abcdef";
+    size_t len = 0U;
+    for (; in != nullptr && *in != '\0'; ++in) {
+        unsigned char c = static_cast<unsigned char>(*in);
+        char esc[6];
+        size_t n = 0U;
+        if (c == '"' || c == '\\') {
+            esc[n++] = '\\';
+            esc[n++] = static_cast<char>(c);
+        } else if (c == '\n') {
+            esc[n++] = '\\';
+            esc[n++] = 'n';
+        } else if (c < 0x20U) {
+            esc[n++] = '\\';
+            esc[n++] = 'u';
+            esc[n++] = '0';
+            esc[n++] = '0';
+            esc[n++] = HEX[c >> 4];
+            esc[n++] = HEX[c & 0x0FU];
+        } else {
+            esc[n++] = static_cast<char>(c);
+        }
+        if (len + n >= outSize) {
+            break;
+        }
+        memcpy(out + len, esc, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+uint32_t backoffDelay(uint8_t attempt, uint32_t baseMs, uint32_t maxMs) {
+    uint32_t delay = baseMs;
+    for (uint8_t i = 0U; i < attempt && delay < maxMs; ++i) {
+        delay = delay > maxMs / 2U ? maxMs : delay * 2U;
+    }
+    return delay < maxMs ? delay : maxMs;
+}
+
+bool nextBatchCommand(const char *&msg, size_t &len, const char *&cmd,
+                      size_t &cmdLen) {
+    while (msg != nullptr && len > 0U) {
+        size_t end = 0U;
+        while (end < len && msg[end] != ';' && msg[end] != '\n') {
+            ++end;
+        }
+        const char *start = msg;
+        size_t n = end;
+        // Consume the separator as well
+        msg += end < len ? end + 1U : end;
+        len -= end < len ? end + 1U : end;
+        while (n > 0U && isSpace(*start)) {
+            ++start;
+            --n;
+        }
+        while (n > 0U && isSpace(start[n - 1U])) {
+            --n;
+        }
+        if (n > 0U) {
+            cmd = start;
+            cmdLen = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+const size_t Command::MAX_LEDS;
+const size_t LineAssembler::CAPACITY;
+
+LineAssembler::LineAssembler()
+    : buf_(), len_(0U), overflow_(false), ready_(false) {}
+
+bool LineAssembler::push(char c) {
+    if (ready_) {
+        len_ = 0U;
+        ready_ = false;
+    }
+    if (c == '\n') {
+        bool dropped = overflow_;
+        overflow_ = false;
+        while (len_ > 0U && isSpace(buf_[len_ - 1U])) {
+            --len_;
+        }
+        buf_[len_] = '\0';
+        if (dropped || len_ == 0U) {
+            len_ = 0U;
+            return false;
+        }
+        ready_ = true;
+        return true;
+    }
+    if (overflow_ || (len_ == 0U && isSpace(c))) {
+        return false;
+    }
+    if (len_ + 1U >= CAPACITY) {
+        overflow_ = true;
+        len_ = 0U;
+        return false;
+    }
+    buf_[len_++] = c;
+    return false;
+}
+
+static const uint8_t GZIP_ID1 = 0x1F;
+static const uint8_t GZIP_ID2 = 0x8B;
+static const uint8_t GZIP_DEFLATE = 8;
+static const size_t GZIP_FIXED_HEADER = 10;
+static const uint8_t GZIP_FHCRC = 0x02;
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+static const uint8_t GZIP_RESERVED = 0xE0;
+
+GzipHeader::GzipHeader()
+    : field_(FIXED), flags_(0), remaining_(GZIP_FIXED_HEADER),
+      extraLen_(0), invalid_(false) {}
+
+// Move on to the next field present in the header
+void GzipHeader::next() {
+    for (;;) {
+        field_ = static_cast<Field>(field_ + 1);
+        switch (field_) {
+        case EXTRA_LEN:
+            if (flags_ & GZIP_FEXTRA) {
+                remaining_ = 2;
+                return;
+            }
+            field_ = EXTRA;  // Skip the extra data as well
+            break;
+        case NAME:
+            if (flags_ & GZIP_FNAME) {
+                return;
+            }
+            break;
+        case COMMENT:
+            if (flags_ & GZIP_FCOMMENT) {
+                return;
+            }
+            break;
+        case HCRC:
+            if (flags_ & GZIP_FHCRC) {
+                remaining_ = 2;
+                return;
+            }
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+GzipHeader::Status GzipHeader::feed(const uint8_t *data, size_t len,
+                                    size_t &used) {
+    used = 0U;
+    while (!invalid_ && field_ != END && used < len) {
+        uint8_t c = data[used++];
+        switch (field_) {
+        case FIXED: {
+            size_t pos = GZIP_FIXED_HEADER - remaining_;
+            if ((pos == 0U && c != GZIP_ID1) || (pos == 1U && c != GZIP_ID2) ||
+                (pos == 2U && c != GZIP_DEFLATE) ||
+                (pos == 3U && (c & GZIP_RESERVED))) {
+                invalid_ = true;
+            }
+            if (pos == 3U) {
+                flags_ = c;
+            }
+            if (--remaining_ == 0U) {
+                next();
+            }
+            break;
+        }
+        case EXTRA_LEN:
+            // XLEN is little endian
+            if (remaining_ == 2U) {
+                extraLen_ = c;
+                --remaining_;
+            } else {
+                remaining_ = static_cast<uint16_t>(extraLen_ | (c << 8));
+                field_ = EXTRA;
+                if (remaining_ == 0U) {
+                    next();
+                }
+            }
+            break;
+        case EXTRA:
+            if (--remaining_ == 0U) {
+                next();
+            }
+            break;
+        case NAME:
+        case COMMENT:
+            if (c == 0U) {
+                next();
+            }
+            break;
+        case HCRC:
+            if (--remaining_ == 0U) {
+                next();
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (invalid_) {
+        return INVALID;
+    }
+    return field_ == END ? DONE : MORE;
+}
+
+bool checkGzipTrailer(const uint8_t *trailer, uint32_t crc, uint32_t size) {
+    return trailer != nullptr && readLe32(trailer) == crc &&
+           readLe32(trailer + 4) == size;
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len) {
+    // Half-byte table for the reflected polynomial 0xEDB88320
+    static const uint32_t TABLE[16] = {
+        0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+        0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+        0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+        0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL};
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ TABLE[crc & 0x0FU];
+        crc = (crc >> 4) ^ TABLE[crc & 0x0FU];
+    }
+    return ~crc;
+}
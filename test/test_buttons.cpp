@@ -0,0 +1,44 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "debounce.h"
+#include "spsc_queue.h"
+
+void test_spsc_queue_order_and_capacity() {
+    SpscQueue<int, 4> q;
+    int v = 0;
+    TEST_ASSERT_FALSE(q.pop(v));
+    TEST_ASSERT_TRUE(q.push(1));
+    TEST_ASSERT_TRUE(q.push(2));
+    TEST_ASSERT_TRUE(q.push(3));
+    TEST_ASSERT_FALSE(q.push(4));
+    TEST_ASSERT_TRUE(q.pop(v));
+    TEST_ASSERT_EQUAL(1, v);
+    TEST_ASSERT_TRUE(q.push(4));
+    TEST_ASSERT_TRUE(q.pop(v));
+    TEST_ASSERT_EQUAL(2, v);
+    TEST_ASSERT_TRUE(q.pop(v));
+    TEST_ASSERT_EQUAL(3, v);
+    TEST_ASSERT_TRUE(q.pop(v));
+    TEST_ASSERT_EQUAL(4, v);
+    TEST_ASSERT_FALSE(q.pop(v));
+}
+
+void test_debounce_ignores_bounce() {
+    Debouncer b(50);
+    TEST_ASSERT_TRUE(b.edge(true, 1000));
+    TEST_ASSERT_FALSE(b.edge(false, 1002));
+    TEST_ASSERT_FALSE(b.edge(true, 1004));
+    TEST_ASSERT_FALSE(b.poll(1060));
+    TEST_ASSERT_TRUE(b.pressed());
+    TEST_ASSERT_TRUE(b.edge(false, 1200));
+    TEST_ASSERT_FALSE(b.pressed());
+}
+
+void test_debounce_short_tap_released_after_window() {
+    Debouncer b(50);
+    TEST_ASSERT_TRUE(b.edge(true, 1000));
+    TEST_ASSERT_FALSE(b.edge(false, 1020));
+    TEST_ASSERT_FALSE(b.poll(1040));
+    TEST_ASSERT_TRUE(b.poll(1050));
+    TEST_ASSERT_FALSE(b.pressed());
+}
@@ -0,0 +1,145 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include <cstring>
+#include "utils.h"
+
+static bool parse(const char *msg, Command &cmd) {
+    return parseCommand(msg, strlen(msg), cmd);
+}
+
+void test_command_span_not_terminated() {
+    // Only the first 5 bytes belong to the message
+    const char buf[] = "set:12345";
+    Command cmd;
+    TEST_ASSERT_TRUE(parseCommand(buf, 5, cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::SET);
+    TEST_ASSERT_EQUAL_UINT32(1, cmd.value);
+}
+
+void test_command_exact_keyword() {
+    Command cmd;
+    TEST_ASSERT_FALSE(parse("nextx", cmd));
+    TEST_ASSERT_FALSE(parse("set", cmd));
+    TEST_ASSERT_FALSE(parse("bright:", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::UNKNOWN);
+}
+
+void test_command_frame() {
+    Command cmd;
+    TEST_ASSERT_TRUE(parse("frame:16", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::FRAME);
+    TEST_ASSERT_EQUAL_UINT32(16, cmd.value);
+    TEST_ASSERT_FALSE(parse("frame:0", cmd));
+    TEST_ASSERT_TRUE(parse("frame:1000", cmd));
+    TEST_ASSERT_FALSE(parse("frame:1001", cmd));
+    TEST_ASSERT_FALSE(parse("frame:999999999", cmd));
+}
+
+void test_command_fade() {
+    Command cmd;
+    TEST_ASSERT_TRUE(parse("fade:0", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::FADE);
+    TEST_ASSERT_EQUAL_UINT32(0, cmd.value);
+    TEST_ASSERT_TRUE(parse("fade:10000", cmd));
+    TEST_ASSERT_EQUAL_UINT32(10000, cmd.value);
+    TEST_ASSERT_FALSE(parse("fade:10001", cmd));
+    TEST_ASSERT_FALSE(parse("fade:", cmd));
+}
+
+void test_command_sync() {
+    Command cmd;
+    TEST_ASSERT_TRUE(parse("sync:leader", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::SYNC);
+    TEST_ASSERT_TRUE(cmd.value == static_cast<uint32_t>(SyncRole::LEADER));
+    TEST_ASSERT_TRUE(parse("sync:off", cmd));
+    TEST_ASSERT_TRUE(cmd.value == static_cast<uint32_t>(SyncRole::OFF));
+    TEST_ASSERT_FALSE(parse("sync:lead", cmd));
+    TEST_ASSERT_FALSE(parse("sync", cmd));
+}
+
+void test_command_play() {
+    Command cmd;
+    TEST_ASSERT_TRUE(parse("play", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::PLAY);
+    TEST_ASSERT_FALSE(parse("play:1", cmd));
+}
+
+void test_command_save() {
+    Command cmd;
+    TEST_ASSERT_TRUE(parse("save", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::SAVE);
+    TEST_ASSERT_FALSE(parse("save:1", cmd));
+    TEST_ASSERT_TRUE(parse("stats", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::STATS);
+}
+
+void test_command_leds_without_hash() {
+    Command cmd;
+    TEST_ASSERT_TRUE(parse("leds:010203,#0a0b0c", cmd));
+    TEST_ASSERT_TRUE(cmd.type == CommandType::LEDS);
+    TEST_ASSERT_EQUAL(2, cmd.ledCount);
+    TEST_ASSERT_EQUAL_HEX32(0x010203, cmd.leds[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x0a0b0c, cmd.leds[1]);
+}
+
+void test_command_color_span() {
+    uint32_t val;
+    TEST_ASSERT_TRUE(parseHexColor("a0b0c0,", 6, val));
+    TEST_ASSERT_EQUAL_HEX32(0xa0b0c0, val);
+    TEST_ASSERT_FALSE(parseHexColor("a0b0c", 5, val));
+}
+
+void test_command_strip_token() {
+    const char buf[] = "secret:next";
+    const char *msg = buf;
+    size_t len = strlen(buf);
+    TEST_ASSERT_FALSE(stripToken(msg, len, "secre"));
+    TEST_ASSERT_TRUE(stripToken(msg, len, "secret"));
+    TEST_ASSERT_EQUAL(4, len);
+    TEST_ASSERT_EQUAL_STRING_LEN("next", msg, len);
+}
+
+void test_led_frame_valid() {
+    const uint8_t data[] = {LED_FRAME_RGB, 0x00, 0x02, 1, 2, 3, 4, 5, 6};
+    LedFrame frame;
+    TEST_ASSERT_TRUE(parseLedFrame(data, sizeof(data), frame));
+    TEST_ASSERT_EQUAL_UINT16(2, frame.start);
+    TEST_ASSERT_EQUAL_UINT16(2, frame.count);
+    TEST_ASSERT_EQUAL_UINT8(4, frame.rgb[3]);
+}
+
+void test_led_frame_invalid() {
+    const uint8_t partial[] = {LED_FRAME_RGB, 0x00, 0x00, 1, 2};
+    const uint8_t opcode[] = {0x7f, 0x00, 0x00, 1, 2, 3};
+    const uint8_t header[] = {LED_FRAME_RGB, 0x00, 0x00};
+    LedFrame frame;
+    TEST_ASSERT_FALSE(parseLedFrame(partial, sizeof(partial), frame));
+    TEST_ASSERT_FALSE(parseLedFrame(opcode, sizeof(opcode), frame));
+    TEST_ASSERT_FALSE(parseLedFrame(header, sizeof(header), frame));
+}
+
+void test_batch_split() {
+    const char *msg = " next ;bright:128\r\n\n;color:#00ff00;";
+    size_t len = strlen(msg);
+    const char *cmd = nullptr;
+    size_t cmdLen = 0;
+    TEST_ASSERT_TRUE(nextBatchCommand(msg, len, cmd, cmdLen));
+    TEST_ASSERT_EQUAL(4, cmdLen);
+    TEST_ASSERT_EQUAL_MEMORY("next", cmd, 4);
+    TEST_ASSERT_TRUE(nextBatchCommand(msg, len, cmd, cmdLen));
+    TEST_ASSERT_EQUAL_MEMORY("bright:128", cmd, cmdLen);
+    TEST_ASSERT_TRUE(nextBatchCommand(msg, len, cmd, cmdLen));
+    TEST_ASSERT_EQUAL_MEMORY("color:#00ff00", cmd, cmdLen);
+    TEST_ASSERT_FALSE(nextBatchCommand(msg, len, cmd, cmdLen));
+    TEST_ASSERT_EQUAL(0, len);
+}
+
+void test_batch_single_command() {
+    const char *msg = "prev";
+    size_t len = 4;
+    const char *cmd = nullptr;
+    size_t cmdLen = 0;
+    TEST_ASSERT_TRUE(nextBatchCommand(msg, len, cmd, cmdLen));
+    TEST_ASSERT_EQUAL(4, cmdLen);
+    TEST_ASSERT_FALSE(nextBatchCommand(msg, len, cmd, cmdLen));
+}
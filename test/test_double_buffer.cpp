@@ -0,0 +1,33 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include <cstdint>
+#include "double_buffer.h"
+
+struct Sample {
+    uint8_t preset;
+    uint8_t brightness;
+    uint32_t interval;
+};
+
+void test_double_buffer_read_latest() {
+    DoubleBuffer<Sample> buf;
+    buf.write(Sample{1, 10, 20});
+    buf.write(Sample{2, 30, 40});
+    Sample out{};
+    buf.read(out);
+    TEST_ASSERT_EQUAL_UINT8(2, out.preset);
+    TEST_ASSERT_EQUAL_UINT8(30, out.brightness);
+    TEST_ASSERT_EQUAL_UINT32(40, out.interval);
+}
+
+void test_double_buffer_generation() {
+    DoubleBuffer<Sample> buf;
+    TEST_ASSERT_EQUAL_UINT32(0, buf.generation());
+    buf.write(Sample{1, 2, 3});
+    buf.write(Sample{4, 5, 6});
+    buf.write(Sample{7, 8, 9});
+    TEST_ASSERT_EQUAL_UINT32(3, buf.generation());
+    Sample out{};
+    buf.read(out);
+    TEST_ASSERT_EQUAL_UINT8(7, out.preset);
+}
@@ -0,0 +1,161 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "effects.h"
+
+namespace {
+
+const uint16_t LEDS = 13;
+
+uint32_t frameHash(const CRGB *leds, uint16_t count) {
+    uint32_t h = 2166136261UL;
+    for (uint16_t i = 0; i < count; ++i) {
+        const uint8_t rgb[3] = {leds[i].r, leds[i].g, leds[i].b};
+        for (uint8_t c : rgb) {
+            h ^= c;
+            h *= 16777619UL;
+        }
+    }
+    return h;
+}
+
+EffectParams goldenParams(const CRGB *custom) {
+    EffectParams p;
+    p.color = CRGB(0x123456);
+    p.leds = custom;
+    p.ledCount = LEDS;
+    p.stepMs = 50;
+    return p;
+}
+
+}  // namespace
+
+// Frame hashes at 0, 275, 1000 and 12345 ms for each PresetType, rendered
+// with the FastLED shim from a fixed random seed. A change here means the
+// effect output changed; update the table only if that was intended.
+void test_effect_golden_frames() {
+    static const uint32_t GOLDEN[PRESET_TYPE_COUNT][4] = {
+        {0xD745A24FUL, 0xD745A24FUL, 0xD745A24FUL, 0xD745A24FUL},  // STATIC
+        {0x78839DF1UL, 0x9E992459UL, 0x27AC9C3DUL, 0x081FA921UL},  // RAINBOW
+        {0x081F3D2FUL, 0x2C6DAF6EUL, 0x081F3D2FUL, 0x2C6DAF6EUL},  // POLICE_NL
+        {0xC6F4D36EUL, 0x2BFF9BA7UL, 0xAF32A446UL, 0xAF32A446UL},  // POLICE_USA
+        {0x2BFF9BA7UL, 0x1E98DA90UL, 0x2BFF9BA7UL, 0x2BFF9BA7UL},  // STROBE
+        {0xDBE370E1UL, 0xBA9836B5UL, 0x4E346238UL, 0x44C142D3UL},  // LAVALAMP
+        {0x73B715BFUL, 0x53A4A9F4UL, 0x209578A7UL, 0xF8051881UL},  // FIRE
+        {0x15E4D702UL, 0x761207A5UL, 0xED1780E5UL, 0x194621FCUL},  // CANDLE
+        {0x6A54FB68UL, 0xB02BA135UL, 0x433B7B87UL, 0x437D3F9AUL},  // PARTY
+        {0x19635750UL, 0x19635750UL, 0x19635750UL, 0x19635750UL},  // CUSTOM
+    };
+    static const uint32_t TIMES[4] = {0, 275, 1000, 12345};
+    CRGB custom[LEDS];
+    for (uint16_t i = 0; i < LEDS; ++i)
+        custom[i] = CRGB(i * 19, 255 - i * 7, i * 3);
+    for (size_t t = 0; t < PRESET_TYPE_COUNT; ++t) {
+        EffectEngine engine;
+        random16_set_seed(1337);
+        engine.activate(static_cast<PresetType>(t), goldenParams(custom));
+        CRGB out[LEDS];
+        for (size_t f = 0; f < 4; ++f) {
+            engine.render(out, LEDS, TIMES[f]);
+            TEST_ASSERT_EQUAL_HEX32_MESSAGE(GOLDEN[t][f], frameHash(out, LEDS),
+                                            "golden frame mismatch");
+        }
+    }
+}
+
+void test_effect_static_and_custom() {
+    CRGB custom[LEDS];
+    for (uint16_t i = 0; i < LEDS; ++i)
+        custom[i] = CRGB(i, i, i);
+    EffectEngine engine;
+    engine.activate(PresetType::STATIC, goldenParams(custom));
+    CRGB out[LEDS];
+    TEST_ASSERT_TRUE(engine.render(out, LEDS, 0));
+    TEST_ASSERT_TRUE(out[12] == CRGB(0x123456));
+    TEST_ASSERT_FALSE(engine.render(out, LEDS, 5000));
+    TEST_ASSERT_FALSE(engine.animated());
+
+    engine.activate(PresetType::CUSTOM, goldenParams(custom));
+    TEST_ASSERT_TRUE(engine.render(out, LEDS, 5000));
+    TEST_ASSERT_TRUE(out[7] == CRGB(7, 7, 7));
+}
+
+void test_effect_strobe_follows_step_time() {
+    EffectEngine engine;
+    EffectParams p;
+    p.stepMs = 100;
+    engine.activate(PresetType::STROBE, p);
+    CRGB out[LEDS];
+    engine.render(out, LEDS, 0);
+    TEST_ASSERT_TRUE(out[0] == CRGB(CRGB::Black));
+    TEST_ASSERT_FALSE(engine.render(out, LEDS, 99));
+    TEST_ASSERT_TRUE(engine.render(out, LEDS, 100));
+    TEST_ASSERT_TRUE(out[0] == CRGB(CRGB::White));
+    TEST_ASSERT_TRUE(engine.animated());
+}
+
+void test_crossfade_kernel() {
+    TEST_ASSERT_EQUAL_UINT8(0, crossfadeAmount(0, 300));
+    TEST_ASSERT_EQUAL_UINT8(127, crossfadeAmount(150, 300));
+    TEST_ASSERT_EQUAL_UINT8(255, crossfadeAmount(300, 300));
+    TEST_ASSERT_EQUAL_UINT8(255, crossfadeAmount(5, 0));
+
+    CRGB from[2] = {CRGB(200, 0, 100), CRGB(CRGB::White)};
+    CRGB to[2] = {CRGB(0, 200, 100), CRGB(CRGB::Black)};
+    CRGB out[2];
+    crossfade(from, to, 0, out, 2);
+    TEST_ASSERT_TRUE(out[0] == from[0]);
+    crossfade(from, to, 255, out, 2);
+    TEST_ASSERT_TRUE(out[1] == to[1]);
+    crossfade(from, to, 128, out, 2);
+    TEST_ASSERT_UINT8_WITHIN(2, 100, out[0].r);
+    TEST_ASSERT_UINT8_WITHIN(2, 100, out[0].g);
+    TEST_ASSERT_UINT8_WITHIN(2, 100, out[0].b);
+    TEST_ASSERT_UINT8_WITHIN(2, 128, out[1].r);
+}
+
+void test_effect_sync_phase() {
+    TEST_ASSERT_EQUAL_UINT32(2 * PHASE_ONE, extrapolatePhase(0, 100, 50));
+    TEST_ASSERT_EQUAL_UINT32(PHASE_ONE, extrapolatePhase(2 * PHASE_ONE, -50,
+                                                         50));
+
+    // An engine started later catches up with the leader's phase
+    EffectParams p;
+    p.stepMs = 50;
+    EffectEngine leader;
+    EffectEngine follower;
+    leader.activate(PresetType::POLICE_NL, p);
+    follower.activate(PresetType::POLICE_NL, p);
+    CRGB a[LEDS];
+    CRGB b[LEDS];
+    leader.render(a, LEDS, 1000);
+    leader.render(a, LEDS, 3210);
+    follower.render(b, LEDS, 7000);
+    follower.syncPhase(leader.phase(), 7000);
+    follower.render(b, LEDS, 7000);
+    TEST_ASSERT_EQUAL_UINT32(leader.phase(), follower.phase());
+    TEST_ASSERT_EQUAL_MEMORY(a, b, sizeof(a));
+    leader.render(a, LEDS, 3260);
+    follower.render(b, LEDS, 7050);
+    TEST_ASSERT_EQUAL_MEMORY(a, b, sizeof(a));
+}
+
+void test_effect_police_nl_segments() {
+    // Two lenses of different size alternate; the gap LED stays dark
+    const LedSegment lenses[] = {{0, 5}, {6, 7}};
+    EffectParams p;
+    p.stepMs = 50;
+    p.segments = lenses;
+    p.segmentCount = 2;
+    EffectEngine engine;
+    engine.activate(PresetType::POLICE_NL, p);
+    CRGB out[LEDS];
+    engine.render(out, LEDS, 0);
+    TEST_ASSERT_TRUE(out[0] == CRGB(CRGB::Blue));
+    TEST_ASSERT_TRUE(out[4] == CRGB(CRGB::Blue));
+    TEST_ASSERT_TRUE(out[5] == CRGB(CRGB::Black));
+    TEST_ASSERT_TRUE(out[6] == CRGB(CRGB::Black));
+    engine.render(out, LEDS, 250);
+    TEST_ASSERT_TRUE(out[0] == CRGB(CRGB::Black));
+    TEST_ASSERT_TRUE(out[5] == CRGB(CRGB::Black));
+    TEST_ASSERT_TRUE(out[12] == CRGB(CRGB::Blue));
+}
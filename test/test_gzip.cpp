@@ -0,0 +1,49 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "utils.h"
+
+void test_gzip_header_fields() {
+    // gzip -N style header with a file name, then deflate data
+    const uint8_t named[] = {0x1F, 0x8B, 8, 0x08, 1, 2, 3, 4, 0, 3,
+                             'f', 'w', '.', 'b', 'i', 'n', 0, 0xAA};
+    GzipHeader h;
+    size_t used;
+    TEST_ASSERT_EQUAL(GzipHeader::DONE, h.feed(named, sizeof(named), used));
+    TEST_ASSERT_EQUAL_size_t(sizeof(named) - 1, used);
+
+    // Extra field, comment and header CRC, fed one byte at a time
+    const uint8_t full[] = {0x1F, 0x8B, 8, 0x16, 0, 0, 0, 0, 0, 3,
+                            2, 0, 'a', 'b', 'c', 0, 0x12, 0x34};
+    GzipHeader split;
+    for (size_t i = 0; i + 1 < sizeof(full); ++i) {
+        TEST_ASSERT_EQUAL(GzipHeader::MORE, split.feed(full + i, 1, used));
+        TEST_ASSERT_EQUAL_size_t(1, used);
+    }
+    TEST_ASSERT_EQUAL(GzipHeader::DONE,
+                      split.feed(full + sizeof(full) - 1, 1, used));
+}
+
+void test_gzip_header_rejects() {
+    const uint8_t image[] = {0xE9, 0x05, 0x02, 0x20};
+    GzipHeader h;
+    size_t used;
+    TEST_ASSERT_EQUAL(GzipHeader::INVALID, h.feed(image, sizeof(image), used));
+    const uint8_t reserved[] = {0x1F, 0x8B, 8, 0x20, 0, 0, 0, 0, 0, 3};
+    GzipHeader r;
+    TEST_ASSERT_EQUAL(GzipHeader::INVALID,
+                      r.feed(reserved, sizeof(reserved), used));
+}
+
+void test_gzip_crc_and_trailer() {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, crc32Update(0, check, 9));
+    uint32_t crc = crc32Update(0, check, 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, crc32Update(crc, check + 4, 5));
+    TEST_ASSERT_EQUAL_HEX32(0, crc32Update(0, check, 0));
+
+    const uint8_t trailer[GZIP_TRAILER] = {0x26, 0x39, 0xF4, 0xCB,
+                                           9, 0, 0, 0};
+    TEST_ASSERT_TRUE(checkGzipTrailer(trailer, 0xCBF43926UL, 9));
+    TEST_ASSERT_FALSE(checkGzipTrailer(trailer, 0xCBF43926UL, 8));
+    TEST_ASSERT_FALSE(checkGzipTrailer(trailer, 0xCBF43927UL, 9));
+}
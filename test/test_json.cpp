@@ -0,0 +1,18 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "utils.h"
+
+void test_json_escape_special_chars() {
+    char out[32];
+    size_t n = jsonEscape("a\"b\\c\nd\x01", out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("a\\\"b\\\\c\\nd\\u0001", out);
+    TEST_ASSERT_EQUAL(16, n);
+}
+
+void test_json_escape_truncates_whole_escapes() {
+    char out[4];
+    TEST_ASSERT_EQUAL(2, jsonEscape("ab\"", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("ab", out);
+    TEST_ASSERT_EQUAL(0, jsonEscape("x", out, 1));
+    TEST_ASSERT_EQUAL_STRING("", out);
+}
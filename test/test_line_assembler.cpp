@@ -0,0 +1,50 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include <cstring>
+#include <string>
+#include "utils.h"
+
+static int feed(LineAssembler &la, const char *data, std::string &last) {
+    int lines = 0;
+    for (size_t i = 0; data[i] != '\0'; ++i) {
+        if (la.push(data[i])) {
+            last.assign(la.line(), la.length());
+            ++lines;
+        }
+    }
+    return lines;
+}
+
+void test_line_assembler_split_input() {
+    LineAssembler la;
+    std::string line;
+    TEST_ASSERT_EQUAL(0, feed(la, "bri", line));
+    TEST_ASSERT_EQUAL(0, feed(la, "ght:12", line));
+    TEST_ASSERT_EQUAL(1, feed(la, "8\n", line));
+    TEST_ASSERT_EQUAL_STRING("bright:128", line.c_str());
+}
+
+void test_line_assembler_trims_whitespace() {
+    LineAssembler la;
+    std::string line;
+    TEST_ASSERT_EQUAL(1, feed(la, "  next\r\n", line));
+    TEST_ASSERT_EQUAL_STRING("next", line.c_str());
+    TEST_ASSERT_EQUAL(0, feed(la, "\r\n\n", line));
+}
+
+void test_line_assembler_multiple_lines() {
+    LineAssembler la;
+    std::string line;
+    TEST_ASSERT_EQUAL(2, feed(la, "next\nprev\n", line));
+    TEST_ASSERT_EQUAL_STRING("prev", line.c_str());
+}
+
+void test_line_assembler_overflow() {
+    LineAssembler la;
+    std::string line;
+    std::string longLine(LineAssembler::CAPACITY + 10, 'x');
+    longLine += "\n";
+    TEST_ASSERT_EQUAL(0, feed(la, longLine.c_str(), line));
+    TEST_ASSERT_EQUAL(1, feed(la, "set:1\n", line));
+    TEST_ASSERT_EQUAL_STRING("set:1", line.c_str());
+}
@@ -0,0 +1,59 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include <cstdint>
+#include "utils.h"
+
+void test_preset_store_header_roundtrip() {
+    uint8_t buf[PRESET_STORE_HEADER];
+    writePresetStoreHeader(buf, 42, 13);
+    uint16_t count = 0;
+    uint8_t ledCount = 0;
+    TEST_ASSERT_TRUE(readPresetStoreHeader(buf, sizeof(buf), count, ledCount));
+    TEST_ASSERT_EQUAL_UINT16(42, count);
+    TEST_ASSERT_EQUAL_UINT8(13, ledCount);
+}
+
+void test_preset_store_header_rejects_bad_data() {
+    uint8_t buf[PRESET_STORE_HEADER];
+    uint16_t count = 0;
+    uint8_t ledCount = 0;
+    writePresetStoreHeader(buf, 1, 13);
+    TEST_ASSERT_FALSE(readPresetStoreHeader(buf, sizeof(buf) - 1, count,
+                                            ledCount));
+    buf[0] ^= 0xFF;
+    TEST_ASSERT_FALSE(readPresetStoreHeader(buf, sizeof(buf), count,
+                                            ledCount));
+    writePresetStoreHeader(buf, 1, 13);
+    buf[4] = PRESET_STORE_VERSION + 1;
+    TEST_ASSERT_FALSE(readPresetStoreHeader(buf, sizeof(buf), count,
+                                            ledCount));
+    writePresetStoreHeader(buf, 1, 13);
+    buf[5] = 12;  // record size no longer matches the LED count
+    TEST_ASSERT_FALSE(readPresetStoreHeader(buf, sizeof(buf), count,
+                                            ledCount));
+}
+
+void test_preset_record_layout() {
+    TEST_ASSERT_EQUAL(PRESET_REC_LEDS + 39, presetRecordEffects(13));
+    TEST_ASSERT_EQUAL(PRESET_REC_LEDS + 52, presetRecordSize(13));
+}
+
+void test_boot_record_header() {
+    uint8_t buf[BOOT_RECORD_HEADER + presetRecordSize(13)] = {};
+    BootState st;
+    st.preset = 300;
+    st.brightness = 77;
+    st.stepMs = 40;
+    writeBootRecordHeader(buf, st, 13);
+    BootState out;
+    TEST_ASSERT_TRUE(readBootRecordHeader(buf, sizeof(buf), 13, out));
+    TEST_ASSERT_EQUAL_UINT16(300, out.preset);
+    TEST_ASSERT_EQUAL_UINT8(77, out.brightness);
+    TEST_ASSERT_EQUAL_UINT16(40, out.stepMs);
+
+    // Records for another LED count or of the wrong size are ignored
+    TEST_ASSERT_FALSE(readBootRecordHeader(buf, sizeof(buf), 12, out));
+    TEST_ASSERT_FALSE(readBootRecordHeader(buf, sizeof(buf) - 1, 13, out));
+    buf[0] = 0;
+    TEST_ASSERT_FALSE(readBootRecordHeader(buf, sizeof(buf), 13, out));
+}
@@ -0,0 +1,102 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include <string.h>
+#include "effects.h"
+#include "sequence.h"
+
+namespace {
+
+// Two LEDs: red fades to blue over 100 ms, blue to green over 50 ms
+const uint8_t SEQ[] = {
+    SEQUENCE_MAGIC, SEQUENCE_VERSION, SEQUENCE_FLAG_LOOP, 0, 2, 0, 3, 0,
+    100, 0, 255, 0, 0, 255, 0, 0,
+    50, 0, 0, 0, 255, 0, 0, 255,
+    0, 0, 0, 255, 0, 0, 255, 0};
+
+}  // namespace
+
+void test_sequence_parse() {
+    SequenceInfo info;
+    TEST_ASSERT_EQUAL_size_t(sizeof(SEQ), sequenceSize(SEQ));
+    TEST_ASSERT_TRUE(parseSequence(SEQ, sizeof(SEQ), info));
+    TEST_ASSERT_EQUAL_UINT16(2, info.ledCount);
+    TEST_ASSERT_EQUAL_UINT16(3, info.frameCount);
+    TEST_ASSERT_TRUE(info.loop);
+    TEST_ASSERT_EQUAL_UINT32(150, info.durationMs);
+    TEST_ASSERT_TRUE(info.frames == SEQ + SEQUENCE_HEADER);
+
+    TEST_ASSERT_FALSE(parseSequence(SEQ, sizeof(SEQ) - 1, info));
+    uint8_t bad[sizeof(SEQ)];
+    memcpy(bad, SEQ, sizeof(SEQ));
+    bad[1] = SEQUENCE_VERSION + 1;
+    TEST_ASSERT_EQUAL_size_t(0, sequenceSize(bad));
+    TEST_ASSERT_FALSE(parseSequence(bad, sizeof(bad), info));
+    // A loop that takes no time could never be played
+    memcpy(bad, SEQ, sizeof(SEQ));
+    bad[8] = 0;
+    bad[16] = 0;
+    TEST_ASSERT_FALSE(parseSequence(bad, sizeof(bad), info));
+}
+
+void test_sequence_rejects_wrapping_size() {
+    // 21846 LEDs x 65533 frames wraps a 32-bit size to 65524 bytes
+    uint8_t wrap[SEQUENCE_HEADER] = {
+        SEQUENCE_MAGIC, SEQUENCE_VERSION, 0, 0, 0x56, 0x55, 0xFD, 0xFF};
+    SequenceInfo info;
+    TEST_ASSERT_EQUAL_size_t(0, sequenceSize(wrap));
+    TEST_ASSERT_FALSE(parseSequence(wrap, 65524, info));
+    // More LEDs than the effects can drive
+    wrap[4] = EFFECT_MAX_LEDS + 1;
+    wrap[5] = 0;
+    wrap[6] = 1;
+    wrap[7] = 0;
+    TEST_ASSERT_EQUAL_size_t(0, sequenceSize(wrap));
+}
+
+void test_sequence_player_interpolates_and_loops() {
+    SequenceInfo info;
+    TEST_ASSERT_TRUE(parseSequence(SEQ, sizeof(SEQ), info));
+    SequencePlayer player;
+    CRGB out[3];
+    player.start(info, 1000);
+    TEST_ASSERT_TRUE(player.render(out, 3, 1000));
+    TEST_ASSERT_EQUAL_UINT8(255, out[0].r);
+    TEST_ASSERT_EQUAL_UINT8(0, out[0].b);
+    // LEDs past the sequence stay black
+    TEST_ASSERT_EQUAL_UINT8(0, out[2].r);
+
+    TEST_ASSERT_TRUE(player.render(out, 3, 1050));
+    TEST_ASSERT_UINT8_WITHIN(2, 128, out[0].r);
+    TEST_ASSERT_UINT8_WITHIN(2, 127, out[0].b);
+
+    // Blue fades into green, whose zero duration cuts back to red
+    TEST_ASSERT_TRUE(player.render(out, 3, 1149));
+    TEST_ASSERT_UINT8_WITHIN(8, 255, out[0].g);
+    TEST_ASSERT_TRUE(player.render(out, 3, 1150));
+    TEST_ASSERT_EQUAL_UINT8(255, out[0].r);
+    TEST_ASSERT_EQUAL_UINT8(0, out[0].g);
+
+    // Whole passes are skipped after a long gap
+    TEST_ASSERT_TRUE(player.render(out, 3, 1000 + 150 * 1000 + 50));
+    TEST_ASSERT_UINT8_WITHIN(2, 128, out[0].r);
+    TEST_ASSERT_TRUE(player.playing());
+}
+
+void test_sequence_player_stops_on_last_frame() {
+    uint8_t once[sizeof(SEQ)];
+    memcpy(once, SEQ, sizeof(SEQ));
+    once[2] = 0;
+    SequenceInfo info;
+    TEST_ASSERT_TRUE(parseSequence(once, sizeof(once), info));
+    SequencePlayer player;
+    CRGB out[2];
+    player.start(info, 0);
+    TEST_ASSERT_TRUE(player.render(out, 2, 0));
+    TEST_ASSERT_TRUE(player.playing());
+    TEST_ASSERT_TRUE(player.render(out, 2, 200));
+    TEST_ASSERT_FALSE(player.playing());
+    TEST_ASSERT_EQUAL_UINT8(255, out[0].g);
+    TEST_ASSERT_EQUAL_UINT8(0, out[0].b);
+    // The last keyframe is drawn once and then left on screen
+    TEST_ASSERT_FALSE(player.render(out, 2, 300));
+}
@@ -0,0 +1,32 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "stage_stats.h"
+
+void test_stage_stats_summary() {
+    StageStats s;
+    TEST_ASSERT_EQUAL_UINT32(0, s.min());
+    TEST_ASSERT_EQUAL_UINT32(0, s.percentile(990));
+    s.record(10);
+    s.record(20);
+    s.record(30);
+    TEST_ASSERT_EQUAL_UINT32(3, s.count());
+    TEST_ASSERT_EQUAL_UINT32(10, s.min());
+    TEST_ASSERT_EQUAL_UINT32(30, s.max());
+    TEST_ASSERT_EQUAL_UINT32(20, s.avg());
+    TEST_ASSERT_EQUAL_UINT32(30, s.percentile(990));
+    s.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, s.count());
+}
+
+void test_stage_stats_p99_bucket_bound() {
+    StageStats s;
+    for (int i = 0; i < 990; ++i)
+        s.record(100);
+    for (int i = 0; i < 10; ++i)
+        s.record(5000);
+    // 100 falls in [96, 111]
+    TEST_ASSERT_EQUAL_UINT32(111, s.percentile(990));
+    TEST_ASSERT_EQUAL_UINT32(5000, s.percentile(1000));
+    s.record(StageStats::MAX_US * 4);
+    TEST_ASSERT_EQUAL_UINT32(StageStats::MAX_US * 4, s.max());
+}
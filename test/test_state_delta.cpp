@@ -0,0 +1,58 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include <string.h>
+#include "utils.h"
+
+static StateSnapshot snapshot() {
+    StateSnapshot s;
+    s.preset = 1;
+    s.hold = 0;
+    s.bright = 255;
+    s.speed = 50;
+    s.color = 0xFF0000;
+    s.presetCount = 12;
+    s.live = false;
+    return s;
+}
+
+void test_state_delta_full() {
+    char out[STATE_DELTA_MAX];
+    StateSnapshot cur = snapshot();
+    TEST_ASSERT_NOT_EQUAL(0, formatStateDelta(nullptr, cur, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"preset\":1,\"hold\":0,\"bright\":255,\"speed\":50,"
+        "\"color\":\"#ff0000\",\"count\":12,\"live\":false}", out);
+}
+
+void test_state_delta_changed_fields_only() {
+    char out[STATE_DELTA_MAX];
+    StateSnapshot prev = snapshot();
+    StateSnapshot cur = prev;
+    TEST_ASSERT_EQUAL(0, formatStateDelta(&prev, cur, out, sizeof(out)));
+    cur.bright = 128;
+    cur.color = 0x00000A;
+    size_t n = formatStateDelta(&prev, cur, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("{\"bright\":128,\"color\":\"#00000a\"}", out);
+    TEST_ASSERT_EQUAL(strlen(out), n);
+}
+
+void test_state_delta_too_small() {
+    char out[8];
+    StateSnapshot cur = snapshot();
+    TEST_ASSERT_EQUAL(0, formatStateDelta(nullptr, cur, out, sizeof(out)));
+}
+
+void test_state_record() {
+    uint8_t out[STATE_RECORD_SIZE];
+    StateSnapshot cur = snapshot();
+    cur.preset = 258;
+    cur.hold = -1;
+    cur.speed = 70000;
+    cur.color = 0x123456;
+    cur.live = true;
+    encodeStateRecord(cur, out);
+    const uint8_t expected[STATE_RECORD_SIZE] = {
+        0x02, 0x01, 0xFF, 0xFF, 255, 0xFF, 0xFF,
+        0x12, 0x34, 0x56, 12, 0, STATE_FLAG_LIVE};
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, sizeof(out));
+}
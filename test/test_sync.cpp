@@ -0,0 +1,53 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "utils.h"
+
+void test_sync_message_roundtrip() {
+    SyncMessage msg;
+    msg.group = 3;
+    msg.brightness = 128;
+    msg.preset = 513;
+    msg.stepMs = 40;
+    msg.time = 0x89ABCDEFUL;
+    msg.phase = 0x01020304UL;
+    uint8_t buf[SYNC_MESSAGE_SIZE];
+    encodeSyncMessage(msg, buf);
+    TEST_ASSERT_EQUAL_HEX8(SYNC_MAGIC, buf[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xEF, buf[8]);
+
+    SyncMessage out;
+    TEST_ASSERT_TRUE(decodeSyncMessage(buf, sizeof(buf), 3, out));
+    TEST_ASSERT_EQUAL_UINT8(128, out.brightness);
+    TEST_ASSERT_EQUAL_UINT16(513, out.preset);
+    TEST_ASSERT_EQUAL_UINT16(40, out.stepMs);
+    TEST_ASSERT_EQUAL_HEX32(0x89ABCDEFUL, out.time);
+    TEST_ASSERT_EQUAL_HEX32(0x01020304UL, out.phase);
+
+    TEST_ASSERT_FALSE(decodeSyncMessage(buf, sizeof(buf), 4, out));
+    TEST_ASSERT_FALSE(decodeSyncMessage(buf, sizeof(buf) - 1, 3, out));
+    buf[1] = SYNC_VERSION + 1;
+    TEST_ASSERT_FALSE(decodeSyncMessage(buf, sizeof(buf), 3, out));
+}
+
+void test_clock_sync_keeps_fastest_sample() {
+    ClockSync clock(1000);
+    TEST_ASSERT_FALSE(clock.valid());
+    // Remote runs 5000 ms ahead; transit takes 1 to 8 ms
+    clock.sample(10000, 5008);
+    TEST_ASSERT_TRUE(clock.valid());
+    TEST_ASSERT_EQUAL_UINT32(5008, clock.toLocal(10000));
+    clock.sample(10100, 5101);
+    clock.sample(10200, 5206);
+    TEST_ASSERT_EQUAL_UINT32(5001, clock.toLocal(10000));
+
+    // Once the best sample is too old a newer one replaces it
+    clock.sample(11200, 6203);
+    TEST_ASSERT_EQUAL_UINT32(5003, clock.toLocal(10000));
+
+    // Works across the 32-bit wrap of either clock
+    ClockSync wrap(1000);
+    wrap.sample(5, 0xFFFFFFF0UL);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFF0UL, wrap.toLocal(5));
+    wrap.reset();
+    TEST_ASSERT_FALSE(wrap.valid());
+}
@@ -0,0 +1,24 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "topology.h"
+
+namespace {
+
+constexpr StripSpec RIG[] = {{2, 16}, {4, 16}, {5, 24}};
+constexpr LedSegment LENSES[] = {{0, 16}, {16, 16}};
+constexpr LedSegment OVERLONG[] = {{0, 16}, {50, 7}};
+
+static_assert(totalLeds(RIG) == 56, "strip lengths add up");
+static_assert(stripOffset(RIG, 2) == 32, "strips are concatenated");
+static_assert(segmentsFit(LENSES, totalLeds(RIG)), "lenses fit");
+static_assert(!segmentsFit(OVERLONG, totalLeds(RIG)), "segment overruns");
+
+}  // namespace
+
+void test_topology_layout() {
+    TEST_ASSERT_EQUAL_UINT16(0, stripOffset(RIG, 0));
+    TEST_ASSERT_EQUAL_UINT16(16, stripOffset(RIG, 1));
+    TEST_ASSERT_EQUAL_UINT16(topology::LED_COUNT,
+                             totalLeds(topology::STRIPS));
+    TEST_ASSERT_TRUE(segmentsFit(topology::SEGMENTS, topology::LED_COUNT));
+}
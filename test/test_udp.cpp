@@ -0,0 +1,94 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include <cstring>
+#include "utils.h"
+
+static size_t buildDdp(uint8_t *buf, uint8_t flags, uint8_t seq,
+                       uint32_t offset, uint16_t len) {
+    buf[0] = flags;
+    buf[1] = seq;
+    buf[2] = 0x0B;
+    buf[3] = 0x01;
+    buf[4] = offset >> 24;
+    buf[5] = offset >> 16;
+    buf[6] = offset >> 8;
+    buf[7] = offset;
+    buf[8] = len >> 8;
+    buf[9] = len;
+    return DDP_HEADER + len;
+}
+
+static size_t buildE131(uint8_t *buf, uint16_t universe, uint8_t seq,
+                        uint16_t slots) {
+    memset(buf, 0, E131_HEADER);
+    const uint8_t id[] = "ASC-E1.17";
+    buf[1] = 0x10;
+    memcpy(buf + 4, id, 9);
+    buf[21] = 0x04;
+    buf[43] = 0x02;
+    buf[111] = seq;
+    buf[113] = universe >> 8;
+    buf[114] = universe;
+    buf[117] = 0x02;
+    buf[118] = 0xA1;
+    buf[122] = 0x01;
+    buf[123] = (slots + 1) >> 8;
+    buf[124] = slots + 1;
+    return E131_HEADER + slots;
+}
+
+void test_ddp_header() {
+    uint8_t buf[64];
+    size_t len = buildDdp(buf, 0x41, 3, 6, 9);
+    PixelPacket pkt;
+    TEST_ASSERT_TRUE(parseDdpHeader(buf, len, pkt));
+    TEST_ASSERT_EQUAL(DDP_HEADER, pkt.headerLen);
+    TEST_ASSERT_EQUAL_UINT32(6, pkt.offset);
+    TEST_ASSERT_EQUAL(9, pkt.dataLen);
+    TEST_ASSERT_EQUAL_UINT8(3, pkt.sequence);
+    TEST_ASSERT_TRUE(pkt.push);
+
+    // Declared length beyond the packet is clamped
+    TEST_ASSERT_TRUE(parseDdpHeader(buf, len - 3, pkt));
+    TEST_ASSERT_EQUAL(6, pkt.dataLen);
+
+    // Timecode header and rejected variants
+    buildDdp(buf, 0x50, 0, 0, 3);
+    TEST_ASSERT_TRUE(parseDdpHeader(buf, DDP_HEADER + DDP_TIMECODE + 3, pkt));
+    TEST_ASSERT_EQUAL(DDP_HEADER + DDP_TIMECODE, pkt.headerLen);
+    TEST_ASSERT_FALSE(pkt.push);
+    buildDdp(buf, 0x80, 0, 0, 3);
+    TEST_ASSERT_FALSE(parseDdpHeader(buf, len, pkt));
+    buildDdp(buf, 0x48, 0, 0, 3);
+    TEST_ASSERT_FALSE(parseDdpHeader(buf, len, pkt));
+    TEST_ASSERT_FALSE(parseDdpHeader(buf, DDP_HEADER - 1, pkt));
+}
+
+void test_e131_header() {
+    uint8_t buf[E131_HEADER + 39];
+    size_t len = buildE131(buf, 1, 200, 39);
+    PixelPacket pkt;
+    TEST_ASSERT_TRUE(parseE131Header(buf, len, 1, pkt));
+    TEST_ASSERT_EQUAL(E131_HEADER, pkt.headerLen);
+    TEST_ASSERT_EQUAL(39, pkt.dataLen);
+    TEST_ASSERT_EQUAL_UINT8(200, pkt.sequence);
+    TEST_ASSERT_FALSE(parseE131Header(buf, len, 2, pkt));
+    buf[112] = 0x40;  // Stream terminated
+    TEST_ASSERT_FALSE(parseE131Header(buf, len, 1, pkt));
+    buf[112] = 0;
+    buf[125] = 0xDD;  // Not DMX data
+    TEST_ASSERT_FALSE(parseE131Header(buf, len, 1, pkt));
+}
+
+void test_sequence_check() {
+    SequenceCheck seq(256, 19);
+    TEST_ASSERT_TRUE(seq.accept(250));
+    TEST_ASSERT_TRUE(seq.accept(251));
+    TEST_ASSERT_FALSE(seq.accept(251));
+    TEST_ASSERT_FALSE(seq.accept(240));
+    TEST_ASSERT_TRUE(seq.accept(2));
+    TEST_ASSERT_EQUAL_UINT32(6, seq.lost());
+    TEST_ASSERT_EQUAL_UINT32(2, seq.late());
+    seq.reset();
+    TEST_ASSERT_TRUE(seq.accept(100));
+}
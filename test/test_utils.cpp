@@ -18,6 +18,65 @@ void test_speed_invalid();
 void test_speed_nonnumeric();
 void test_leds_bad_data();
 void test_wifi_form_hostname();
+void test_template_full_render();
+void test_template_unknown_marker();
+void test_template_too_many_segments();
+void test_double_buffer_read_latest();
+void test_double_buffer_generation();
+void test_line_assembler_split_input();
+void test_line_assembler_trims_whitespace();
+void test_line_assembler_multiple_lines();
+void test_line_assembler_overflow();
+void test_command_span_not_terminated();
+void test_command_exact_keyword();
+void test_command_frame();
+void test_command_save();
+void test_command_leds_without_hash();
+void test_command_color_span();
+void test_command_strip_token();
+void test_led_frame_valid();
+void test_led_frame_invalid();
+void test_preset_store_header_roundtrip();
+void test_preset_store_header_rejects_bad_data();
+void test_preset_record_layout();
+void test_batch_split();
+void test_batch_single_command();
+void test_spsc_queue_order_and_capacity();
+void test_debounce_ignores_bounce();
+void test_debounce_short_tap_released_after_window();
+void test_stage_stats_summary();
+void test_stage_stats_p99_bucket_bound();
+void test_effect_golden_frames();
+void test_effect_static_and_custom();
+void test_effect_strobe_follows_step_time();
+void test_crossfade_kernel();
+void test_command_fade();
+void test_write_behind_waits_for_quiet();
+void test_write_behind_bounds_delay();
+void test_boot_record_header();
+void test_topology_layout();
+void test_effect_police_nl_segments();
+void test_sync_message_roundtrip();
+void test_clock_sync_keeps_fastest_sample();
+void test_effect_sync_phase();
+void test_command_sync();
+void test_ddp_header();
+void test_e131_header();
+void test_sequence_check();
+void test_json_escape_special_chars();
+void test_json_escape_truncates_whole_escapes();
+void test_state_delta_full();
+void test_state_delta_changed_fields_only();
+void test_state_delta_too_small();
+void test_state_record();
+void test_command_play();
+void test_sequence_parse();
+void test_sequence_rejects_wrapping_size();
+void test_sequence_player_interpolates_and_loops();
+void test_sequence_player_stops_on_last_frame();
+void test_gzip_header_fields();
+void test_gzip_header_rejects();
+void test_gzip_crc_and_trailer();
 
 void test_valid_color() {
     uint32_t val;
@@ -46,6 +105,15 @@ void test_invalid_chars_upper() {
     TEST_ASSERT_FALSE(parseHexColor("FF00FG", val));
 }
 
+void test_backoff_delay() {
+    TEST_ASSERT_EQUAL_UINT32(500, backoffDelay(0, 500, 60000));
+    TEST_ASSERT_EQUAL_UINT32(4000, backoffDelay(3, 500, 60000));
+    TEST_ASSERT_EQUAL_UINT32(60000, backoffDelay(7, 500, 60000));
+    TEST_ASSERT_EQUAL_UINT32(60000, backoffDelay(255, 500, 60000));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL,
+                             backoffDelay(40, 3, 0xFFFFFFFFUL));
+}
+
 int main(int argc, char **argv) {
     UNITY_BEGIN();
     RUN_TEST(test_valid_color);
@@ -53,6 +121,7 @@ int main(int argc, char **argv) {
     RUN_TEST(test_invalid_length);
     RUN_TEST(test_invalid_chars);
     RUN_TEST(test_invalid_chars_upper);
+    RUN_TEST(test_backoff_delay);
     RUN_TEST(test_next_message);
     RUN_TEST(test_set_message);
     RUN_TEST(test_brightness_message);
@@ -68,6 +137,65 @@ int main(int argc, char **argv) {
     RUN_TEST(test_speed_nonnumeric);
     RUN_TEST(test_leds_bad_data);
     RUN_TEST(test_wifi_form_hostname);
+    RUN_TEST(test_template_full_render);
+    RUN_TEST(test_template_unknown_marker);
+    RUN_TEST(test_template_too_many_segments);
+    RUN_TEST(test_double_buffer_read_latest);
+    RUN_TEST(test_double_buffer_generation);
+    RUN_TEST(test_line_assembler_split_input);
+    RUN_TEST(test_line_assembler_trims_whitespace);
+    RUN_TEST(test_line_assembler_multiple_lines);
+    RUN_TEST(test_line_assembler_overflow);
+    RUN_TEST(test_command_span_not_terminated);
+    RUN_TEST(test_command_exact_keyword);
+    RUN_TEST(test_command_frame);
+    RUN_TEST(test_command_save);
+    RUN_TEST(test_command_leds_without_hash);
+    RUN_TEST(test_command_color_span);
+    RUN_TEST(test_command_strip_token);
+    RUN_TEST(test_led_frame_valid);
+    RUN_TEST(test_led_frame_invalid);
+    RUN_TEST(test_preset_store_header_roundtrip);
+    RUN_TEST(test_preset_store_header_rejects_bad_data);
+    RUN_TEST(test_preset_record_layout);
+    RUN_TEST(test_batch_split);
+    RUN_TEST(test_batch_single_command);
+    RUN_TEST(test_spsc_queue_order_and_capacity);
+    RUN_TEST(test_debounce_ignores_bounce);
+    RUN_TEST(test_debounce_short_tap_released_after_window);
+    RUN_TEST(test_stage_stats_summary);
+    RUN_TEST(test_stage_stats_p99_bucket_bound);
+    RUN_TEST(test_effect_golden_frames);
+    RUN_TEST(test_effect_static_and_custom);
+    RUN_TEST(test_effect_strobe_follows_step_time);
+    RUN_TEST(test_crossfade_kernel);
+    RUN_TEST(test_command_fade);
+    RUN_TEST(test_write_behind_waits_for_quiet);
+    RUN_TEST(test_write_behind_bounds_delay);
+    RUN_TEST(test_boot_record_header);
+    RUN_TEST(test_topology_layout);
+    RUN_TEST(test_effect_police_nl_segments);
+    RUN_TEST(test_sync_message_roundtrip);
+    RUN_TEST(test_clock_sync_keeps_fastest_sample);
+    RUN_TEST(test_effect_sync_phase);
+    RUN_TEST(test_command_sync);
+    RUN_TEST(test_ddp_header);
+    RUN_TEST(test_e131_header);
+    RUN_TEST(test_sequence_check);
+    RUN_TEST(test_json_escape_special_chars);
+    RUN_TEST(test_json_escape_truncates_whole_escapes);
+    RUN_TEST(test_state_delta_full);
+    RUN_TEST(test_state_delta_changed_fields_only);
+    RUN_TEST(test_state_delta_too_small);
+    RUN_TEST(test_state_record);
+    RUN_TEST(test_command_play);
+    RUN_TEST(test_sequence_parse);
+    RUN_TEST(test_sequence_rejects_wrapping_size);
+    RUN_TEST(test_sequence_player_interpolates_and_loops);
+    RUN_TEST(test_sequence_player_stops_on_last_frame);
+    RUN_TEST(test_gzip_header_fields);
+    RUN_TEST(test_gzip_header_rejects);
+    RUN_TEST(test_gzip_crc_and_trailer);
     return UNITY_END();
 }
 
@@ -1,16 +1,23 @@
 #include <unity.h>
 // Copyright 2025 Bootj05
 #include <string>
+#include "utils.h"
 
+// Mirrors handleWifiForm(): stream the template pieces and fill markers
 static std::string renderWifiForm(const std::string &tpl,
                                   const std::string &ssid,
                                   const std::string &host) {
-    std::string html = tpl;
-    size_t pos;
-    while ((pos = html.find("%SSID%")) != std::string::npos)
-        html.replace(pos, 6, ssid);
-    while ((pos = html.find("%HOST%")) != std::string::npos)
-        html.replace(pos, 6, host);
+    static const char *const markers[] = {"SSID", "HOST"};
+    TemplateSegment segs[8];
+    size_t n = splitTemplate(tpl.c_str(), markers, 2, segs, 8);
+    std::string html;
+    for (size_t i = 0; i < n; ++i) {
+        html.append(segs[i].text, segs[i].len);
+        if (segs[i].marker == 0)
+            html += ssid;
+        else if (segs[i].marker == 1)
+            html += host;
+    }
     return html;
 }
 
@@ -21,3 +28,19 @@ void test_wifi_form_hostname() {
     TEST_ASSERT_NOT_EQUAL(std::string::npos, html.find("MyDevice"));
 }
 
+void test_template_full_render() {
+    std::string html = renderWifiForm("a%SSID%b%HOST%c%SSID%", "x", "y");
+    TEST_ASSERT_EQUAL_STRING("axbycx", html.c_str());
+}
+
+void test_template_unknown_marker() {
+    std::string html = renderWifiForm("100% %FOO% %SSID", "x", "y");
+    TEST_ASSERT_EQUAL_STRING("100% %FOO% %SSID", html.c_str());
+}
+
+void test_template_too_many_segments() {
+    static const char *const markers[] = {"A"};
+    TemplateSegment segs[2];
+    TEST_ASSERT_EQUAL(2, splitTemplate("x%A%y", markers, 1, segs, 2));
+    TEST_ASSERT_EQUAL(0, splitTemplate("x%A%y%A%", markers, 1, segs, 2));
+}
@@ -0,0 +1,30 @@
+// Copyright 2025 Bootj05
+#include <unity.h>
+#include "write_behind.h"
+
+void test_write_behind_waits_for_quiet() {
+    WriteBehind w(3000, 30000);
+    TEST_ASSERT_FALSE(w.due(0));
+    w.mark(1000);
+    TEST_ASSERT_TRUE(w.dirty());
+    TEST_ASSERT_FALSE(w.due(3999));
+    w.mark(3500);  // Another change restarts the quiet period
+    TEST_ASSERT_FALSE(w.due(6000));
+    TEST_ASSERT_TRUE(w.due(6500));
+    w.clear();
+    TEST_ASSERT_FALSE(w.due(100000));
+}
+
+void test_write_behind_bounds_delay() {
+    WriteBehind w(3000, 10000);
+    uint32_t now = 0xFFFFF000UL;  // Across the millis() wrap
+    w.mark(now);
+    for (int i = 0; i < 9; ++i) {
+        now += 1000;
+        w.mark(now);
+        TEST_ASSERT_FALSE(w.due(now));
+    }
+    now += 1000;
+    w.mark(now);
+    TEST_ASSERT_TRUE(w.due(now));
+}
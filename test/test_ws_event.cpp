@@ -1,9 +1,7 @@
 // Copyright 2025 Bootj05
 #include <unity.h>
-#include <string>
 #include <vector>
 #include <cstdint>
-#include <cstdlib>
 #include "utils.h"
 
 // Minimal stand-ins for firmware globals and helpers
@@ -34,82 +32,50 @@ static void previousPreset() {
 
 enum WStype_t { WStype_TEXT };
 
+// Mirrors wsEvent()/handleCommand() in goggles.ino on top of the shared
+// parseCommand() from utils.cpp
 static void wsEvent(uint8_t /*num*/, WStype_t type, uint8_t *payload,
-                    size_t /*len*/) {
+                    size_t len) {
     if (type != WStype_TEXT)
         return;
-    std::string msg(reinterpret_cast<char *>(payload));
+    Command cmd;
+    if (!parseCommand(reinterpret_cast<const char *>(payload), len, cmd))
+        return;
 
-    if (msg == "next") {
+    switch (cmd.type) {
+    case CommandType::NEXT:
         nextPreset();
-    } else if (msg == "prev") {
+        break;
+    case CommandType::PREV:
         previousPreset();
-    } else if (msg.rfind("set:", 0) == 0) {
-        std::string idxStr = msg.substr(4);
-        if (!idxStr.empty() &&
-            idxStr.find_first_not_of("0123456789") == std::string::npos) {
-            int idx = std::stoi(idxStr);
-            if (idx >= 0 && idx < static_cast<int>(presets.size())) {
-                currentPreset = idx;
-                applyPreset();
-            }
-        }
-    } else if (msg.rfind("bright:", 0) == 0) {
-        std::string valStr = msg.substr(7);
-        if (!valStr.empty() &&
-            valStr.find_first_not_of("0123456789") == std::string::npos) {
-            int val = std::stoi(valStr);
-            if (val >= 0 && val <= 255) {
-                brightness = static_cast<uint8_t>(val);
-                applyPreset();
-            }
-        }
-    } else if (msg.rfind("color:", 0) == 0) {
-        std::string colorStr = msg.substr(6);
-        if (colorStr.size() == 7 && colorStr[0] == '#') {
-            colorStr.erase(0, 1);
-            uint32_t val;
-            if (parseHexColor(colorStr.c_str(), val)) {
-                presets[currentPreset].color = val;
-                applyPreset();
-            }
-        }
-    } else if (msg.rfind("speed:", 0) == 0) {
-        std::string valStr = msg.substr(6);
-        if (!valStr.empty() &&
-            valStr.find_first_not_of("0123456789") == std::string::npos) {
-            int val = std::stoi(valStr);
-            if (val > 0)
-                animInterval = static_cast<uint32_t>(val);
-        }
-    } else if (msg.rfind("leds:", 0) == 0) {
-        std::string data = msg.substr(5);
-        std::vector<uint32_t> temp(NUM_LEDS, 0);
-        size_t idx = 0;
-        bool valid = true;
-        while (idx < NUM_LEDS && !data.empty()) {
-            size_t sep = data.find(',');
-            std::string tok =
-                sep == std::string::npos ? data : data.substr(0, sep);
-            if (!tok.empty() && tok[0] == '#')
-                tok.erase(0, 1);
-            uint32_t val;
-            if (parseHexColor(tok.c_str(), val)) {
-                temp[idx] = val;
-            } else {
-                valid = false;
-                break;
-            }
-            if (sep == std::string::npos)
-                data.clear();
-            else
-                data.erase(0, sep + 1);
-            ++idx;
-        }
-        if (valid && data.empty()) {
-            presets[currentPreset].leds = temp;
+        break;
+    case CommandType::SET:
+        if (cmd.value < presets.size()) {
+            currentPreset = static_cast<int>(cmd.value);
             applyPreset();
         }
+        break;
+    case CommandType::BRIGHT:
+        brightness = static_cast<uint8_t>(cmd.value);
+        applyPreset();
+        break;
+    case CommandType::COLOR:
+        presets[currentPreset].color = cmd.value;
+        applyPreset();
+        break;
+    case CommandType::SPEED:
+        animInterval = cmd.value;
+        break;
+    case CommandType::LEDS: {
+        std::vector<uint32_t> temp(NUM_LEDS, 0);
+        for (size_t i = 0; i < cmd.ledCount && i < NUM_LEDS; ++i)
+            temp[i] = cmd.leds[i];
+        presets[currentPreset].leds = temp;
+        applyPreset();
+        break;
+    }
+    default:
+        break;
     }
 }
 
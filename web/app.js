@@ -0,0 +1,88 @@
+// Renders the static page from /api/state so the device only generates
+// the dynamic data on each request.
+(function () {
+  'use strict';
+
+  var list = document.getElementById('presets');
+  var hold = document.getElementById('hold');
+  var bright = document.getElementById('bright');
+  var state = null;
+  var socket = null;
+
+  // The control endpoints answer with a redirect to "/"; there is no need
+  // to download the page again, so the redirect is not followed. While the
+  // WebSocket is open the resulting state change is pushed to us anyway.
+  function send(url) {
+    return fetch(url, {redirect: 'manual'}).then(function () {
+      if (!socket || socket.readyState !== WebSocket.OPEN)
+        return load();
+    });
+  }
+
+  function render() {
+    bright.value = state.bright;
+    list.textContent = '';
+    hold.textContent = '';
+    state.presets.forEach(function (p, i) {
+      var item = document.createElement('li');
+      item.className = 'list-group-item';
+      item.textContent = p.name;
+      if (i === state.preset) {
+        var badge = document.createElement('span');
+        badge.className = 'badge';
+        badge.textContent = 'active';
+        item.appendChild(badge);
+      }
+      item.onclick = function () {
+        send('/set?i=' + i);
+      };
+      list.appendChild(item);
+
+      var opt = document.createElement('option');
+      opt.value = i;
+      opt.textContent = p.name;
+      opt.selected = i === state.hold;
+      hold.appendChild(opt);
+    });
+  }
+
+  function load() {
+    return fetch('/api/state').then(function (r) {
+      return r.json();
+    }).then(function (s) {
+      state = s;
+      render();
+    });
+  }
+
+  // The firmware broadcasts only the fields that changed. The preset list
+  // itself is not part of the deltas, so refetch it when its size changes.
+  function connect() {
+    socket = new WebSocket('ws://' + location.hostname + ':81/');
+    socket.onmessage = function (ev) {
+      var delta = JSON.parse(ev.data);
+      if (!state || ('count' in delta && delta.count !== state.presets.length)) {
+        load();
+        return;
+      }
+      Object.keys(delta).forEach(function (k) {
+        state[k] = delta[k];
+      });
+      render();
+    };
+    socket.onclose = function () {
+      setTimeout(connect, 2000);
+    };
+  }
+
+  document.querySelectorAll('[data-action]').forEach(function (b) {
+    b.onclick = function () {
+      send(b.getAttribute('data-action'));
+    };
+  });
+  bright.onchange = function () {
+    send('/bright?b=' + bright.value);
+  };
+  load();
+  connect();
+})();